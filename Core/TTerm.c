@@ -38,30 +38,105 @@
 #include "TTerm_cmd.h"
 #include "TTerm_AC.h"
 #include "TTerm_cwd.h"
+#include "TTerm_line.h"
+#include "TTerm_printf.h"
+
+#if TERM_PERFECT_HASH == 1
+//generated by tools/tterm_phash.py
+#include "TTerm_phash.h"
+#endif
 
 #include "apps.h"
 
-TermCommandDescriptor TERM_defaultList = {.nextCmd = 0, .commandLength = 0};
+//length of the command queue of every terminal and of every program
+#define TERM_CMD_QUEUE_LENGTH 16
+#define TERM_PROG_QUEUE_LENGTH 5
+
+//with TERM_STATIC_ALLOCATION the history is a fixed array in the handle, an empty string marks an unused entry (empty lines never get there)
+#if TERM_STATIC_ALLOCATION == 1
+#define TERM_hasHistoryEntry(handle, index) ((handle)->historyBuffer[index][0] != 0)
+#else
+#define TERM_hasHistoryEntry(handle, index) ((handle)->historyBuffer[index] != 0)
+#endif
+
+#if TERM_STATIC_COMMANDS == 1
+static TermCommandIndex TERM_defaultIndex = {.staticCommands = __tterm_cmd_start, .staticCommandsEnd = __tterm_cmd_end};
+#else
+static TermCommandIndex TERM_defaultIndex;
+#endif
+TermCommandDescriptor TERM_defaultList = {.nextCmd = 0, .commandLength = 0, .index = &TERM_defaultIndex};
 unsigned TERM_baseCMDsAdded = 0;
 
 static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle);
+static void TERM_handlePaste(uint8_t * data, uint32_t length, TERMINAL_HANDLE * handle);
+static void TERM_freeCommandTrie(TermCommandDescriptor * head);
+#if TERM_SERVICE_TASK == 1 && (!__is_compiling || __has_include("FreeRTOS.h"))
+static void TERM_serviceTask(void * pvData);
+#endif
+#if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h")) && defined TERM_WORKER_STACK_CLASSES
+static void TERM_initWorkers();
+static TermProgram * TERM_claimWorker(uint32_t stackSize);
+static void TERM_releaseWorker(TermProgram * prog);
+#endif
+#if TERM_MAX_JOBS > 0 && (!__is_compiling || __has_include("FreeRTOS.h"))
+static TermJob * TERM_getBackgroundJob(TERMINAL_HANDLE * handle);
+static unsigned TERM_writeToJob(TERMINAL_HANDLE * handle, const TermIovec * data, uint32_t count);
+#endif
+
 
+#if TERM_STATIC_COMMANDS == 1
+TERM_STATIC_COMMAND("help", CMD_help, "Displays this help message", TERM_DEFAULT_STACKSIZE);
+TERM_STATIC_COMMAND("cls", CMD_cls, "Clears the screen", TERM_DEFAULT_STACKSIZE);
+#if TERM_MAX_JOBS > 0
+TERM_STATIC_COMMAND("jobs", CMD_jobs, "Lists the background jobs", TERM_INLINE_STACKSIZE);
+TERM_STATIC_COMMAND("fg", CMD_fg, "Brings a job to the foreground", TERM_INLINE_STACKSIZE);
+TERM_STATIC_COMMAND("bg", CMD_bg, "Continues a stopped job in the background", TERM_INLINE_STACKSIZE);
+#endif
+#if TERM_CMD_STATS == 1
+TERM_STATIC_COMMAND("cmdstat", CMD_cmdstat, "Lists how much stack the commands used", TERM_INLINE_STACKSIZE);
+#endif
+#ifdef TERM_RESET_FUNCTION
+TERM_STATIC_COMMAND("reset", CMD_reset, "resets the fibernet", TERM_DEFAULT_STACKSIZE);
+#endif
+#if TERM_SUPPORT_CWD == 1
+TERM_STATIC_COMMAND_AC("cat", CMD_cat, "a cat in the terminal?", 0, CWD_pathCompleter, 0);
+TERM_STATIC_COMMAND("ls", CMD_ls, "List directory", 0);
+TERM_STATIC_COMMAND_AC("cd", CMD_cd, "Change directory", 0, CWD_pathCompleter, 0);
+TERM_STATIC_COMMAND_AC("mkdir", CMD_mkdir, "Make directory", 0, CWD_pathCompleter, 0);
+#endif
+TERM_STATIC_COMMAND_AC("test", CMD_testCommandHandler, "tests stuff", TERM_DEFAULT_STACKSIZE+500, ACL_defaultCompleter, &CMD_testACL);
+#endif
 
 #if EXTENDED_PRINTF == 1
-TERMINAL_HANDLE * TERM_createNewHandle(TermPrintHandler printFunction, void * port, unsigned echoEnabled, TermCommandDescriptor * cmdListHead, TermErrorPrinter errorPrinter, const char * usr){
+TERMINAL_HANDLE * TERM_createNewHandle(TermPrintHandler printFunction, TermWriteHandler writeFunction, void * port, unsigned echoEnabled, TermCommandDescriptor * cmdListHead, TermErrorPrinter errorPrinter, const char * usr){
 #else
-TERMINAL_HANDLE * TERM_createNewHandle(TermPrintHandler printFunction, unsigned echoEnabled, TermCommandDescriptor * cmdListHead, TermErrorPrinter errorPrinter, const char * usr){    
+TERMINAL_HANDLE * TERM_createNewHandle(TermPrintHandler printFunction, TermWriteHandler writeFunction, unsigned echoEnabled, TermCommandDescriptor * cmdListHead, TermErrorPrinter errorPrinter, const char * usr){    
 #endif    
     
     //reserve memory
     TERMINAL_HANDLE * newHandle = TERM_MALLOC(sizeof(TERMINAL_HANDLE));
+    if(newHandle == NULL) return NULL;
     memset(newHandle, 0, sizeof(TERMINAL_HANDLE));
     
     newHandle->inputBuffer = TERM_MALLOC(TERM_INPUTBUFFER_SIZE);
+    newHandle->outputBuffer = TERM_MALLOC(TERM_OUTPUTBUFFER_SIZE);
+    newHandle->lineShadow = TERM_MALLOC(TERM_INPUTBUFFER_SIZE);
+    newHandle->autocompleteLine = TERM_MALLOC(TERM_INPUTBUFFER_SIZE);
     newHandle->currUserName = TERM_MALLOC(strlen(usr) + 1 + strlen(TERM_getVT100Code(_VT100_FOREGROUND_COLOR, _VT100_YELLOW)) + strlen(TERM_getVT100Code(_VT100_RESET_ATTRIB, 0)));
+    if(newHandle->inputBuffer == NULL || newHandle->outputBuffer == NULL || newHandle->lineShadow == NULL || newHandle->autocompleteLine == NULL || newHandle->currUserName == NULL){
+        if(newHandle->inputBuffer != NULL) TERM_FREE(newHandle->inputBuffer);
+        if(newHandle->outputBuffer != NULL) TERM_FREE(newHandle->outputBuffer);
+        if(newHandle->lineShadow != NULL) TERM_FREE(newHandle->lineShadow);
+        if(newHandle->autocompleteLine != NULL) TERM_FREE(newHandle->autocompleteLine);
+        if(newHandle->currUserName != NULL) TERM_FREE(newHandle->currUserName);
+        TERM_FREE(newHandle);
+        return NULL;
+    }
+    TERM_lineClear(newHandle);
     
     //initialise function pointers
     newHandle->print = printFunction;  
+    newHandle->write = writeFunction;   //optional, raw output goes through print if this is NULL
     
     if(errorPrinter == 0){
         newHandle->errorPrinter = TERM_defaultErrorPrinter;
@@ -75,7 +150,11 @@ TERMINAL_HANDLE * TERM_createNewHandle(TermPrintHandler printFunction, unsigned
 #endif
 
 #ifdef TERM_startTaskPerCommand
-    newHandle->cmdStream = xQueueCreate(16, sizeof(Term_progCMD_t));
+    newHandle->cmdStream = xQueueCreate(TERM_CMD_QUEUE_LENGTH, sizeof(Term_progCMD_t));
+#ifdef TERM_WORKER_STACK_CLASSES
+    //the pool is shared by all terminals, only the first one creates it
+    TERM_initWorkers();
+#endif
 #endif
     
     newHandle->echoEnabled = echoEnabled;
@@ -84,38 +163,51 @@ TERMINAL_HANDLE * TERM_createNewHandle(TermPrintHandler printFunction, unsigned
     sprintf(newHandle->currUserName, "%s%s%s", TERM_getVT100Code(_VT100_FOREGROUND_COLOR, _VT100_BLUE), usr, TERM_getVT100Code(_VT100_RESET_ATTRIB, 0));
     
     //reset pointers
-    newHandle->currEscSeqPos = 0xff;
+    TERM_initVT100Decoder(&newHandle->vt100Decoder);
+    newHandle->termRows = TERM_DEFAULT_ROWS;
+    newHandle->termColumns = TERM_DEFAULT_COLUMNS;
     
 #if TERM_SUPPORT_CWD == 1
     newHandle->cwdPath = TERM_MALLOC(2);
-    strcpy(newHandle->cwdPath, "/");
+    if(newHandle->cwdPath != NULL) strcpy(newHandle->cwdPath, "/");
 #endif
 
-    //if this is the first console we initialize we need to add the static commands
+    //if this is the first console we initialize we need to add the base commands (unless they are in flash already, see below)
     if(!TERM_baseCMDsAdded){
         TERM_baseCMDsAdded = 1;
         
+#if TERM_STATIC_COMMANDS != 1
         TERM_addCommand(CMD_help, "help", "Displays this help message", TERM_DEFAULT_STACKSIZE, &TERM_defaultList);
         TERM_addCommand(CMD_cls, "cls", "Clears the screen", TERM_DEFAULT_STACKSIZE, &TERM_defaultList);
+        
+#if TERM_MAX_JOBS > 0
+        TERM_addCommand(CMD_jobs, "jobs", "Lists the background jobs", TERM_INLINE_STACKSIZE, &TERM_defaultList);
+        TERM_addCommand(CMD_fg, "fg", "Brings a job to the foreground", TERM_INLINE_STACKSIZE, &TERM_defaultList);
+        TERM_addCommand(CMD_bg, "bg", "Continues a stopped job in the background", TERM_INLINE_STACKSIZE, &TERM_defaultList);
+#endif
+#if TERM_CMD_STATS == 1
+        TERM_addCommand(CMD_cmdstat, "cmdstat", "Lists how much stack the commands used", TERM_INLINE_STACKSIZE, &TERM_defaultList);
+#endif
 
 #ifdef TERM_RESET_FUNCTION
         TERM_addCommand(CMD_reset, "reset", "resets the fibernet", TERM_DEFAULT_STACKSIZE, &TERM_defaultList);
 #endif
         
 #if TERM_SUPPORT_CWD == 1
-        TERM_addCommand(CMD_cat, "cat", "a cat in the terminal?", 0, &TERM_defaultList);
+        TERM_addCommandAC(TERM_addCommand(CMD_cat, "cat", "a cat in the terminal?", 0, &TERM_defaultList), CWD_pathCompleter, 0);
         TERM_addCommand(CMD_ls, "ls", "List directory", 0, &TERM_defaultList);
-        TERM_addCommand(CMD_cd, "cd", "Change directory", 0, &TERM_defaultList);
-        TERM_addCommand(CMD_mkdir, "mkdir", "Make directory", 0, &TERM_defaultList);
+        TERM_addCommandAC(TERM_addCommand(CMD_cd, "cd", "Change directory", 0, &TERM_defaultList), CWD_pathCompleter, 0);
+        TERM_addCommandAC(TERM_addCommand(CMD_mkdir, "mkdir", "Make directory", 0, &TERM_defaultList), CWD_pathCompleter, 0);
 #endif  
         
       
         TermCommandDescriptor * test = TERM_addCommand(CMD_testCommandHandler, "test", "tests stuff", TERM_DEFAULT_STACKSIZE+500, &TERM_defaultList);
-        head = ACL_create();
+        TERM_addCommandAC(test, ACL_defaultCompleter, head);  
+#endif
+        //the test list can be edited with the test command, so it always lives in ram
         ACL_add(head, "-ra");
         ACL_add(head, "-r");
         ACL_add(head, "-aa");
-        TERM_addCommandAC(test, ACL_defaultCompleter, head);  
         
         REGISTER_apps(&TERM_defaultList);
     }
@@ -126,6 +218,16 @@ TERMINAL_HANDLE * TERM_createNewHandle(TermPrintHandler printFunction, unsigned
     //TODO colors in the boot message
     TERM_printBootMessage(newHandle);
 #endif
+
+#if TERM_SERVICE_TASK == 1
+    //input only gets to the task through the stream, the semaphore tells it that there is some. Messages from programs wake it up directly
+    newHandle->feedStream = xStreamBufferCreate(TERM_FEED_BUFFER_SIZE, 1);
+    newHandle->feedSignal = xSemaphoreCreateBinary();
+    newHandle->eventSet = xQueueCreateSet(TERM_CMD_QUEUE_LENGTH + 1);
+    xQueueAddToSet(newHandle->cmdStream, newHandle->eventSet);
+    xQueueAddToSet(newHandle->feedSignal, newHandle->eventSet);
+    xTaskCreate(TERM_serviceTask, "TTerm", TERM_SERVICE_STACK_SIZE, (void*) newHandle, TERM_SERVICE_PRIORITY, &newHandle->serviceTask);
+#endif
     return newHandle;
 }
 
@@ -136,10 +238,21 @@ void TERM_destroyHandle(TERMINAL_HANDLE * handle){
         (*handle->currProgram->inputHandler)(handle, 0x03);
     }
 #endif
+
+#if TERM_SERVICE_TASK == 1
+    vTaskDelete(handle->serviceTask);
+    vQueueDelete(handle->eventSet);
+    vSemaphoreDelete(handle->feedSignal);
+    vStreamBufferDelete(handle->feedStream);
+#endif
     
     TERM_FREE(handle->inputBuffer);
+    TERM_FREE(handle->outputBuffer);
+    TERM_FREE(handle->lineShadow);
+    TERM_FREE(handle->autocompleteLine);
     TERM_FREE(handle->currUserName);
     
+#if TERM_STATIC_ALLOCATION == 0
     uint8_t currHistoryPos = 0;
     for(;currHistoryPos < TERM_HISTORYSIZE; currHistoryPos++){
         if(handle->historyBuffer[currHistoryPos] != 0){
@@ -147,182 +260,507 @@ void TERM_destroyHandle(TERMINAL_HANDLE * handle){
             handle->historyBuffer[currHistoryPos] = 0;
         }
     }
+#endif
     
-    TERM_FREE(handle->autocompleteBuffer);
-    handle->autocompleteBuffer = NULL;
+    TERM_clearCompletion(handle);
+#if TERM_SUPPORT_CWD == 1
+    CWD_releaseListing(handle);
+#endif
     TERM_FREE(handle);
 }
 
 void TERM_printDebug(TERMINAL_HANDLE * handle, char * format, ...){
     //is handle valid?
-    if(handle == NULL) return;
+    if(handle == NULL || !handle->currEchoEnabled) return;
     
-    //TODO make this nicer... we don't need a double buffer allocation, we should instead send the va_list to the print function. But it is way to late at night for me to code this now...
     //TODO implement a debug level control in the terminal handle (permission level?)
     va_list arg;
     va_start(arg, format);
     
-    char * buff = (char*) TERM_MALLOC(256);
-    vsnprintf(buff, 256,format, arg);
+    ttwriteLiteral("\r\n");
+    TERM_vprintf(handle, format, arg);
     
-    ttprintfEcho("\r\n%s", buff);
+    TERM_printPrompt(handle, "");
+    if(handle->currBufferLength != 0) TERM_linePrint(handle);
     
-    if(handle->currBufferLength == 0){
-        ttprintfEcho("%s@%s>", handle->currUserName, TERM_DEVICE_NAME);
-    }else{
-        ttprintfEcho("%s@%s>%s", handle->currUserName, TERM_DEVICE_NAME, handle->inputBuffer);
-        if(handle->inputBuffer[handle->currBufferPosition] != 0) TERM_sendVT100Code(handle, _VT100_CURSOR_BACK_BY, handle->currBufferLength - handle->currBufferPosition);
+    va_end(arg);
+}
+
+static void TERM_printfSink(void * context, const char * data, uint32_t length){
+    TERM_write((TERMINAL_HANDLE *) context, data, length);
+}
+
+//printf through the built in formatter (see TTerm_printf.h). Output goes the same way as TERM_write, so into the output buffer if that is active and to the port without any heap use otherwise
+uint32_t TERM_printf(TERMINAL_HANDLE * handle, const char * format, ...){
+    va_list arg;
+    va_start(arg, format);
+    uint32_t length = TERM_vformat(TERM_printfSink, handle, format, arg);
+    va_end(arg);
+    return length;
+}
+
+uint32_t TERM_vprintf(TERMINAL_HANDLE * handle, const char * format, va_list arg){
+    return TERM_vformat(TERM_printfSink, handle, format, arg);
+}
+
+void TERM_startOutputBuffering(TERMINAL_HANDLE * handle){
+    //only the task that started buffering may write into the buffer, everyone else keeps printing directly
+#if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
+    if(handle->outputBufferDepth == 0) handle->outputBufferOwner = xTaskGetCurrentTaskHandle();
+#endif
+    handle->outputBufferDepth ++;
+}
+
+void TERM_stopOutputBuffering(TERMINAL_HANDLE * handle){
+    if(handle->outputBufferDepth == 0) return;
+    
+    //send everything once the outermost user of the buffer is done
+    if(--handle->outputBufferDepth == 0) TERM_flushOutput(handle);
+}
+
+unsigned TERM_isOutputBuffered(TERMINAL_HANDLE * handle){
+#if TERM_MAX_JOBS > 0
+    //prints of a job in the background are collected in the job until it gets into the foreground again
+    if(TERM_getBackgroundJob(handle) != NULL) return 1;
+#endif
+    if(handle->outputBufferDepth == 0) return 0;
+#if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
+    return handle->outputBufferOwner == xTaskGetCurrentTaskHandle();
+#else
+    return 1;
+#endif
+}
+
+//hands raw data to the port, bypassing the output buffer
+static void TERM_sendRaw(TERMINAL_HANDLE * handle, const TermIovec * data, uint32_t count){
+    if(handle->write != NULL){
+#if EXTENDED_PRINTF == 1
+        (*handle->write)(handle->port, data, count);
+#else
+        (*handle->write)(data, count);
+#endif
+        return;
+    }
+    
+    //no write handler, go through printf instead
+    uint32_t currVec = 0;
+    for(;currVec < count; currVec++){
+        if(data[currVec].length == 0) continue;
+#if EXTENDED_PRINTF == 1
+        (*handle->print)(handle->port, "%.*s", data[currVec].length, data[currVec].data);
+#else
+        (*handle->print)("%.*s", data[currVec].length, data[currVec].data);
+#endif
+    }
+}
+
+void TERM_flushOutput(TERMINAL_HANDLE * handle){
+    if(handle->outputBufferLength == 0) return;
+    
+    TermIovec data = {.data = handle->outputBuffer, .length = handle->outputBufferLength};
+    TERM_sendRaw(handle, &data, 1);
+    handle->outputBufferLength = 0;
+}
+
+uint32_t TERM_bufferedPrint(TERMINAL_HANDLE * handle, char * format, ...){
+    va_list arg;
+    
+#if TERM_MAX_JOBS > 0
+    if(TERM_getBackgroundJob(handle) != NULL){
+        //the output buffer belongs to the terminal. The built in formatter streams through TERM_write into the job without allocating anything (it knows no floats though, see TTerm_printf.h)
+        va_start(arg, format);
+        uint32_t jobLength = TERM_vprintf(handle, format, arg);
+        va_end(arg);
+        return jobLength;
+    }
+#endif
+    
+    //try to format the string straight into the free space of the buffer
+    uint32_t space = TERM_OUTPUTBUFFER_SIZE - handle->outputBufferLength;
+    va_start(arg, format);
+    int32_t length = vsnprintf(&handle->outputBuffer[handle->outputBufferLength], space, format, arg);
+    va_end(arg);
+    
+    if(length < 0) return 0;
+    
+    if(length < space){
+        //it fit (including the terminator vsnprintf always writes)
+        handle->outputBufferLength += length;
+        return length;
     }
     
-    TERM_FREE(buff);
+    //no space left, send what we already have and try again with the empty buffer
+    TERM_flushOutput(handle);
     
+    va_start(arg, format);
+    if(length < TERM_OUTPUTBUFFER_SIZE){
+        vsnprintf(handle->outputBuffer, TERM_OUTPUTBUFFER_SIZE, format, arg);
+        handle->outputBufferLength = length;
+    }else{
+#if TERM_STATIC_ALLOCATION == 1
+        //the string is bigger than the entire buffer and there is no heap for a bigger one, send what fits and cut off the rest
+        vsnprintf(handle->outputBuffer, TERM_OUTPUTBUFFER_SIZE, format, arg);
+        TermIovec data = {.data = handle->outputBuffer, .length = TERM_OUTPUTBUFFER_SIZE - 1};
+        TERM_sendRaw(handle, &data, 1);
+#else
+        //the string is bigger than the entire buffer, format it into a temporary one and send that directly
+        char * buff = TERM_MALLOC(length + 1);
+        if(buff != NULL){
+            vsnprintf(buff, length + 1, format, arg);
+            TermIovec data = {.data = buff, .length = length};
+            TERM_sendRaw(handle, &data, 1);
+            TERM_FREE(buff);
+        }
+#endif
+    }
     va_end(arg);
+    
+    return length;
 }
 
-uint8_t TERM_processBuffer(uint8_t * data, uint16_t length, TERMINAL_HANDLE * handle){
-    uint16_t currPos = 0;
-    for(;currPos < length; currPos++){
-        //ttprintfEcho("checking 0x%02x\r\n", data[currPos]);
-        if(handle->currEscSeqPos != 0xff){
-            if(handle->currEscSeqPos == 0){
-                if(data[currPos] == '['){
-                    handle->escSeqBuff[handle->currEscSeqPos++] = data[currPos];
-                }else{
-                    switch(data[currPos]){
-                        case 'c':
-                            handle->currEscSeqPos = 0xff;
-                            TERM_handleInput(_VT100_RESET, handle);
-                            break;
-                        case 0x1b:
-                            handle->currEscSeqPos = 0;
-                            break;
-                        default:
-                            handle->currEscSeqPos = 0xff;
-                            TERM_handleInput(0x1b, handle);
-                            TERM_handleInput(data[currPos], handle);
-                            break;
-                    }
-                }
-            }else{
-                if(isACIILetter(data[currPos])){
-                    if(data[currPos] == 'n'){
-                        if(handle->currEscSeqPos == 2){
-                            if(handle->escSeqBuff[0] == '5'){        //Query device status
-                            }else if(handle->escSeqBuff[0] == '6'){  //Query cursor position
-                            }
-                        }
-                    }else if(data[currPos] == 'c'){
-                        if(handle->currEscSeqPos == 1){              //Query device code
-                        }
-                    }else if(data[currPos] == 'F'){
-                        if(handle->currEscSeqPos == 1){              //end
-                            TERM_handleInput(_VT100_KEY_END, handle);
-                        }
-                    }else if(data[currPos] == 'H'){
-                        if(handle->currEscSeqPos == 1){              //pos1
-                            TERM_handleInput(_VT100_KEY_POS1, handle);
-                        }
-                    }else if(data[currPos] == 'C'){                      //cursor forward
-                        if(handle->currEscSeqPos > 1){              
-                            handle->escSeqBuff[handle->currEscSeqPos] = 0;
-                        }else{
-                            TERM_handleInput(_VT100_CURSOR_FORWARD, handle);
-                        }
-                    }else if(data[currPos] == 'D'){                      //cursor backward
-                        if(handle->currEscSeqPos > 1){                 
-                            handle->escSeqBuff[handle->currEscSeqPos] = 0;
-                        }else{
-                            TERM_handleInput(_VT100_CURSOR_BACK, handle);
-                        }
-                    }else if(data[currPos] == 'A'){                      //cursor up
-                        if(handle->currEscSeqPos > 1){                 
-                            handle->escSeqBuff[handle->currEscSeqPos] = 0;
-                        }else{
-                            TERM_handleInput(_VT100_CURSOR_UP, handle);
-                        }
-                    }else if(data[currPos] == 'B'){                      //cursor down
-                        if(handle->currEscSeqPos > 1){                 
-                            handle->escSeqBuff[handle->currEscSeqPos] = 0;
-                        }else{
-                            TERM_handleInput(_VT100_CURSOR_DOWN, handle);
-                        }
-                    }else if(data[currPos] == 'Z'){                      //shift tab or ident request(at least from exp.; didn't find any official spec containing this)
-                        TERM_handleInput(_VT100_BACKWARDS_TAB, handle);
-                        
-                    }else if(data[currPos] == '~'){                      //Tilde the end of a special key command (Esc[{keyID}~)
-                        if(handle->escSeqBuff[1] == 0x32){            //insert       
-                            TERM_handleInput(_VT100_KEY_INS, handle);
-                        }else if(handle->escSeqBuff[1] == 0x33){      //delete     
-                            TERM_handleInput(_VT100_KEY_DEL, handle);
-                        }else if(handle->escSeqBuff[1] == 0x35){      //page up      
-                            TERM_handleInput(_VT100_KEY_PAGE_UP, handle);
-                        }else if(handle->escSeqBuff[1] == 0x36){      //page down 
-                            TERM_handleInput(_VT100_KEY_PAGE_DOWN, handle);
-                        }else{
-                            TERM_handleInput(_VT100_INVALID, handle);
-                        }
-                    }else{                      //others
-                        handle->escSeqBuff[handle->currEscSeqPos+1] = 0;
-                    }
-                    handle->currEscSeqPos = 0xff;
-                }else{
-                    handle->escSeqBuff[handle->currEscSeqPos++] = data[currPos];
-                }
-            }
+//sends data as it is, no format parsing involved
+void TERM_write(TERMINAL_HANDLE * handle, const char * data, uint32_t length){
+    TermIovec vec = {.data = data, .length = length};
+    TERM_writev(handle, &vec, 1);
+}
+
+//sends count pieces of data as if they were one. Ports with a write handler get all of them in one call (f.E. for scatter-gather DMA straight from flash)
+void TERM_writev(TERMINAL_HANDLE * handle, const TermIovec * data, uint32_t count){
+#if TERM_MAX_JOBS > 0
+    if(TERM_writeToJob(handle, data, count)) return;
+#endif
+    
+    if(!TERM_isOutputBuffered(handle)){
+        TERM_sendRaw(handle, data, count);
+        return;
+    }
+    
+    //we are buffering, copy everything into the output buffer
+    uint32_t currVec = 0;
+    for(;currVec < count; currVec++){
+        if(data[currVec].length > TERM_OUTPUTBUFFER_SIZE - handle->outputBufferLength) TERM_flushOutput(handle);
+        
+        if(data[currVec].length >= TERM_OUTPUTBUFFER_SIZE){
+            //doesn't fit even into the empty buffer, send it straight away
+            TERM_sendRaw(handle, &data[currVec], 1);
         }else{
-            if(data[currPos] == 0x1B){     //ESC for VT100 control sequences
-                handle->currEscSeqPos = 0;
-            }else{
-                TERM_handleInput(data[currPos], handle);
-            }
+            memcpy(&handle->outputBuffer[handle->outputBufferLength], data[currVec].data, data[currVec].length);
+            handle->outputBufferLength += data[currVec].length;
         }
     }
 }
 
-unsigned isACIILetter(char c){
-    return (c > 64 && c < 91) || (c > 96 && c < 122) || c == '~';
+//prints "user@device>" preceded by lineBreak
+void TERM_printPrompt(TERMINAL_HANDLE * handle, const char * lineBreak){
+    if(!handle->currEchoEnabled) return;
+    
+    TermIovec prompt[] = {
+        {.data = lineBreak, .length = strlen(lineBreak)},
+        {.data = handle->currUserName, .length = strlen(handle->currUserName)},
+        {.data = "@", .length = 1},
+        {.data = TERM_DEVICE_NAME, .length = strlen(TERM_DEVICE_NAME)},
+        {.data = ">", .length = 1}
+    };
+    TERM_writev(handle, prompt, sizeof(prompt) / sizeof(TermIovec));
 }
 
-void TERM_printBootMessage(TERMINAL_HANDLE * handle){
-    TERM_sendVT100Code(handle, _VT100_RESET, 0); TERM_sendVT100Code(handle, _VT100_CURSOR_POS1, 0); TERM_sendVT100Code(handle, _VT100_WRAP_OFF, 0);
-    ttprintfEcho("\r\n\n\n%s\r\n", TERM_startupText);
+#if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
+//called once a program sent PROG_RETURN (and was reported if it is a job), nothing touches it after that
+static void TERM_freeProgram(TermProgram * prog){
+#ifdef TERM_WORKER_STACK_CLASSES
+    //pooled programs keep everything for the next command
+    if(prog->workerStackSize != 0){
+        TERM_releaseWorker(prog);
+        return;
+    }
+#endif
     
-    if(handle->currBufferLength == 0){
-        ttprintfEcho("\r\n\r\n%s@%s>", handle->currUserName, TERM_DEVICE_NAME);
-    }else{
-        ttprintfEcho("\r\n\r\n%s@%s>%s", handle->currUserName, TERM_DEVICE_NAME, handle->inputBuffer);
-        if(handle->inputBuffer[handle->currBufferPosition] != 0) TERM_sendVT100Code(handle, _VT100_CURSOR_BACK_BY, handle->currBufferLength - handle->currBufferPosition);
+#if TERM_STATIC_ALLOCATION == 0
+    vStreamBufferDelete(prog->inputStream);
+    vQueueDelete(prog->cmdStream);
+    TERM_FREE(prog->commandString);     //the arguments are in the same block
+    TERM_FREE(prog);
+#endif
+}
+#endif
+
+#if TERM_MAX_JOBS > 0 && (!__is_compiling || __has_include("FreeRTOS.h"))
+//the job of prog, NULL if it isn't one
+static TermJob * TERM_findJob(TERMINAL_HANDLE * handle, TermProgram * prog){
+    uint32_t currJob = 0;
+    for(;currJob < TERM_MAX_JOBS; currJob++){
+        if(handle->jobs[currJob].state != JOB_FREE && handle->jobs[currJob].program == prog) return &handle->jobs[currJob];
     }
+    return NULL;
 }
 
-uint8_t TERM_defaultErrorPrinter(TERMINAL_HANDLE * handle, uint32_t retCode){
-    switch(retCode){
-        case TERM_CMD_EXIT_SUCCESS:
-            ttprintfEcho("\r\n%s@%s>", handle->currUserName, TERM_DEVICE_NAME);
-            break;
+static unsigned TERM_hasFreeJob(TERMINAL_HANDLE * handle){
+    uint32_t currJob = 0;
+    for(;currJob < TERM_MAX_JOBS; currJob++){
+        if(handle->jobs[currJob].state == JOB_FREE) return 1;
+    }
+    return 0;
+}
 
-        case TERM_CMD_EXIT_ERROR:
-            ttprintfEcho("\r\nTask returned with error code %d\r\n%s@%s>", retCode, handle->currUserName, TERM_DEVICE_NAME);
-            break;
+//is task the one that handles the input of the terminal?
+static unsigned TERM_isTerminalTask(TERMINAL_HANDLE * handle, TaskHandle_t task){
+#if TERM_SERVICE_TASK == 1
+    if(task == handle->serviceTask) return 1;
+#endif
+    //TERM_processBuffer buffers all the echo it generates
+    return handle->outputBufferDepth != 0 && handle->outputBufferOwner == task;
+}
 
-        case TERM_CMD_EXIT_NOT_FOUND:
-            ttprintfEcho("\"%s\" is not a valid command. Type \"help\" to see a list of available ones\r\n%s@%s>", handle->inputBuffer, handle->currUserName, TERM_DEVICE_NAME);
-            break;
+//the job the calling task runs as in the background of this terminal, NULL if it isn't one
+static TermJob * TERM_getBackgroundJob(TERMINAL_HANDLE * handle){
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    
+    //the terminal is never a job, no need to look for its echo
+    if(TERM_isTerminalTask(handle, task)) return NULL;
+    
+    uint32_t currJob = 0;
+    for(;currJob < TERM_MAX_JOBS; currJob++){
+        //the terminal might end the job while we look at it
+        TermJob * job = &handle->jobs[currJob];
+        TermProgram * prog = job->program;
+        if(job->state != JOB_FREE && job->state != JOB_DONE && prog != NULL && !job->foreground && prog->task == task) return job;
+    }
+    return NULL;
+}
+
+//takes a free slot for prog, NULL if all of them are in use
+static TermJob * TERM_addJob(TERMINAL_HANDLE * handle, TermProgram * prog){
+    uint32_t currJob = 0;
+    for(;currJob < TERM_MAX_JOBS; currJob++){
+        TermJob * job = &handle->jobs[currJob];
+        if(job->state != JOB_FREE) continue;
+        
+        job->program = prog;
+        job->foreground = 0;
+        job->inputMode = INPUTMODE_DIRECT;
+        job->outputStart = 0;
+        job->outputLength = 0;
+        job->outputDropped = 0;
+        job->state = JOB_RUNNING;
+        return job;
+    }
+    return NULL;
+}
+
+static uint32_t TERM_getJobNumber(TERMINAL_HANDLE * handle, TermJob * job){
+    return (job - handle->jobs) + 1;
+}
+
+//appends data to the output of a job, only the newest TERM_JOB_OUTPUT_SIZE bytes are kept
+static void TERM_appendJobOutput(TermJob * job, const char * data, uint32_t length){
+    if(length > TERM_JOB_OUTPUT_SIZE){
+        job->outputDropped += length - TERM_JOB_OUTPUT_SIZE;
+        data += length - TERM_JOB_OUTPUT_SIZE;
+        length = TERM_JOB_OUTPUT_SIZE;
+    }
+    
+    //make room by dropping the oldest data
+    if(job->outputLength + length > TERM_JOB_OUTPUT_SIZE){
+        uint32_t drop = job->outputLength + length - TERM_JOB_OUTPUT_SIZE;
+        job->outputStart = (job->outputStart + drop) % TERM_JOB_OUTPUT_SIZE;
+        job->outputLength -= drop;
+        job->outputDropped += drop;
+    }
+    
+    uint32_t end = (job->outputStart + job->outputLength) % TERM_JOB_OUTPUT_SIZE;
+    uint32_t firstPart = TERM_JOB_OUTPUT_SIZE - end;
+    if(firstPart > length) firstPart = length;
+    
+    memcpy(&job->output[end], data, firstPart);
+    memcpy(job->output, &data[firstPart], length - firstPart);
+    job->outputLength += length;
+}
+
+//puts whatever the calling task prints into its job if it is one in the background. Returns 0 if it isn't
+static unsigned TERM_writeToJob(TERMINAL_HANDLE * handle, const TermIovec * data, uint32_t count){
+    if(TERM_getBackgroundJob(handle) == NULL) return 0;
+    
+    //the terminal may take the job into the foreground at any time (see TERM_flushJobOutput), that must not happen halfway through. So check again with the scheduler stopped
+    vTaskSuspendAll();
+    TermJob * job = TERM_getBackgroundJob(handle);
+    if(job != NULL){
+        uint32_t currVec = 0;
+        for(;currVec < count; currVec++) TERM_appendJobOutput(job, data[currVec].data, data[currVec].length);
+    }
+    xTaskResumeAll();
+    
+    return job != NULL;
+}
+
+//sends everything the job printed in the background. With toForeground set the job prints to the port itself again afterwards.
+//The switch only happens once the buffer is empty, so nothing the job prints in the meantime can overtake what is in there
+static void TERM_flushJobOutput(TERMINAL_HANDLE * handle, TermJob * job, unsigned toForeground){
+    char chunk[64];
+    uint32_t length;
+    uint32_t dropped;
+    uint32_t firstPart;
+    
+    while(1){
+        vTaskSuspendAll();
+        dropped = job->outputDropped;
+        job->outputDropped = 0;
+        
+        length = (job->outputLength < sizeof(chunk)) ? job->outputLength : sizeof(chunk);
+        firstPart = TERM_JOB_OUTPUT_SIZE - job->outputStart;
+        if(firstPart > length) firstPart = length;
+        memcpy(chunk, &job->output[job->outputStart], firstPart);
+        memcpy(&chunk[firstPart], job->output, length - firstPart);
+        job->outputStart = (job->outputStart + length) % TERM_JOB_OUTPUT_SIZE;
+        job->outputLength -= length;
+        
+        if(length == 0 && toForeground) job->foreground = 1;
+        xTaskResumeAll();
+        
+        if(dropped != 0) ttprintf("[%d] %d bytes of output were dropped\r\n", TERM_getJobNumber(handle, job), dropped);
+        if(length == 0) break;
+        ttwrite(chunk, length);
+    }
+}
+
+//job n if there is one
+TermJob * TERM_getJob(TERMINAL_HANDLE * handle, uint32_t number){
+    if(number == 0 || number > TERM_MAX_JOBS || handle->jobs[number - 1].state == JOB_FREE) return NULL;
+    return &handle->jobs[number - 1];
+}
+
+//the job with the highest number, what fg and bg use if they aren't told which one
+TermJob * TERM_getLatestJob(TERMINAL_HANDLE * handle){
+    uint32_t number = TERM_MAX_JOBS;
+    for(;number > 0; number--){
+        if(handle->jobs[number - 1].state != JOB_FREE) return &handle->jobs[number - 1];
+    }
+    return NULL;
+}
+
+//prints "[n] status command args", status defaults to the state of the job
+void TERM_printJob(TERMINAL_HANDLE * handle, TermJob * job, const char * status){
+    char exitStatus[12];
+    if(status == NULL){
+        if(job->state == JOB_STOPPED){
+            status = "Stopped";
+        }else if(job->state != JOB_DONE){
+            status = "Running";
+        }else if(job->returnCode == TERM_CMD_EXIT_SUCCESS){
+            status = "Done";
+        }else{
+            snprintf(exitStatus, sizeof(exitStatus), "Exit %d", job->returnCode);
+            status = exitStatus;
+        }
+    }
+    
+    TermProgram * prog = job->program;
+    ttprintf("[%d] %-11s%s", TERM_getJobNumber(handle, job), status, prog->cmd->command);
+    
+    uint32_t currArg = 0;
+    for(;currArg < prog->argCount; currArg++) ttprintf(" %s", prog->args[currArg]);
+}
+
+//makes job the program in the foreground, printing everything it collected in the background first. Returns 0 if there already is one or the job is done
+unsigned TERM_foregroundJob(TERMINAL_HANDLE * handle, TermJob * job){
+    if(handle->currProgram != NULL || job->state == JOB_DONE) return 0;
+    
+    TERM_flushJobOutput(handle, job, 1);
+    
+    handle->currProgram = job->program;
+    handle->currProgramInputMode = job->inputMode;
+    if(job->inputMode == INPUTMODE_GET_LINE) TERM_lineClear(handle);
+    
+    if(job->state == JOB_STOPPED){
+        job->state = JOB_RUNNING;
+        vTaskResume(job->program->task);
     }
+    return 1;
+}
+
+//continues a stopped job in the background. Returns 0 if it wasn't stopped
+unsigned TERM_resumeJob(TERMINAL_HANDLE * handle, TermJob * job){
+    if(job->state != JOB_STOPPED) return 0;
+    
+    job->state = JOB_RUNNING;
+    vTaskResume(job->program->task);
+    return 1;
+}
+
+//a job returned. The one in the foreground just gives up its slot, one in the background keeps it (and its program) until it is reported by TERM_reportFinishedJobs.
+//Returns 0 if the program has to be kept until then
+static unsigned TERM_endJob(TermJob * job, uint8_t retCode){
+    if(job->foreground){
+        job->state = JOB_FREE;
+        job->program = NULL;
+        return 1;
+    }
+    
+    job->returnCode = retCode;
+    job->state = JOB_DONE;
     return 0;
 }
 
-static void resetInputBuffer(TERMINAL_HANDLE * handle){//reset inputbuffer
-    handle->currBufferPosition = 0;
-    handle->currBufferLength = 0;
-    memset(handle->inputBuffer, 0, TERM_INPUTBUFFER_SIZE);
-    handle->currBufferPosition = 0;
+//tells the user about jobs that finished in the background, along with everything they printed. Like a shell this waits until the prompt is back, so nothing gets into the way of a program in the foreground
+static void TERM_reportFinishedJobs(TERMINAL_HANDLE * handle){
+    if(handle->currProgram != NULL) return;
+    
+    uint32_t currJob = 0;
+    for(;currJob < TERM_MAX_JOBS; currJob++){
+        TermJob * job = &handle->jobs[currJob];
+        if(job->state != JOB_DONE) continue;
+        
+        //the user might have been typing something, print it again below
+        TERM_sendVT100Code(handle, _VT100_ERASE_LINE, 0);
+        ttwriteLiteral("\r");
+        TERM_flushJobOutput(handle, job, 0);
+        TERM_printJob(handle, job, NULL);
+        TERM_printPrompt(handle, "\r\n");
+        TERM_linePrint(handle);
+        
+        TermProgram * prog = job->program;
+        job->state = JOB_FREE;
+        job->program = NULL;
+        TERM_freeProgram(prog);
+    }
+}
+//TERM_JOB_STOP_KEY: stops the program in the foreground and hands the terminal back to the user
+static void TERM_stopForegroundProgram(TERMINAL_HANDLE * handle){
+    TermProgram * prog = handle->currProgram;
+    
+    TermJob * job = TERM_findJob(handle, prog);
+    if(job == NULL) job = TERM_addJob(handle, prog);
+    if(job == NULL){
+        //all slots are taken, it has to keep running
+        ttwriteLiteral("\a");
+        return;
+    }
+    
+    vTaskSuspend(prog->task);
+    
+    job->state = JOB_STOPPED;
+    job->foreground = 0;
+    job->inputMode = handle->currProgramInputMode;
+    
+    handle->currProgram = NULL;
+    handle->currEchoEnabled = handle->echoEnabled;
+    TERM_lineClear(handle);
+    
+    ttwriteLiteral("\r\n");
+    TERM_printJob(handle, job, NULL);
+    TERM_printPrompt(handle, "\r\n");
+    
+    //the prompt is back, anything that finished in the meantime can be reported now
+    TERM_reportFinishedJobs(handle);
 }
 
-static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
+#endif
+
 #if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
-    //check if we have any program commands to process (that could be enterForeground, exitForeground, return etc.)
+static void TERM_processProgramCMDs(TERMINAL_HANDLE * handle){
     Term_progCMD_t currProgCMD;
+#if TERM_MAX_JOBS > 0
+    TermJob * job;
+#endif
     while(xQueueReceive(handle->cmdStream, &currProgCMD, 0)){
         //weeee goooot ooneee ;)
         
@@ -342,25 +780,29 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
                     handle->currProgram = NULL;
                     
                     //reset buffer
-                    resetInputBuffer(handle);
-                }else{
+                    TERM_lineClear(handle);
+                }
+#if TERM_MAX_JOBS > 0
+                
+                //jobs report themselves (the one in the foreground just gives up its slot)
+                if((job = TERM_findJob(handle, currProgCMD.src)) != NULL){
+                    if(!TERM_endJob(job, currProgCMD.arg)) break;
+                }
+#endif
+                else if(handle->currProgram != currProgCMD.src){
                     //no it wasn't, user might have been typing something. Is this the case?
                     if(handle->currBufferLength != 0){
                         //erase the line
                         TERM_sendVT100Code(handle, _VT100_ERASE_LINE, 0);
                         
                         //write the identifier and buffer
-                        ttprintfEcho("\r\n\r\n%s@%s>%s", handle->currUserName, TERM_DEVICE_NAME, handle->inputBuffer);
-                        if(handle->inputBuffer[handle->currBufferPosition] != 0) TERM_sendVT100Code(handle, _VT100_CURSOR_BACK_BY, handle->currBufferLength - handle->currBufferPosition);
+                        TERM_printPrompt(handle, "\r\n\r\n");
+                        TERM_linePrint(handle);
                     }
                 }
                 
                 //free the data. This needs to happen here, as this is the last place in the code the data is accessed after program exit
-                vStreamBufferDelete(currProgCMD.src->inputStream);
-                vQueueDelete(currProgCMD.src->cmdStream);
-                if(currProgCMD.src->argCount != 0) TERM_FREE(currProgCMD.src->args);
-                TERM_FREE(currProgCMD.src->commandString);
-                TERM_FREE(currProgCMD.src);
+                TERM_freeProgram(currProgCMD.src);
 
                 break;
                 
@@ -374,7 +816,7 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
                     //is the new inputmode getLine?
                     if(currProgCMD.arg == INPUTMODE_GET_LINE){
                         //yes, empty out the line buffer
-                        resetInputBuffer(handle);
+                        TERM_lineClear(handle);
                     }
 
                     //assign new inputmode
@@ -382,6 +824,14 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
                 } else{
                     //lol no, it doesn't have a say in the matter...
                     
+#if TERM_MAX_JOBS > 0
+                    //unless it is a job, that gets what it asked for once it is in the foreground again. Until then it waits for input just like it would there
+                    if((job = TERM_findJob(handle, currProgCMD.src)) != NULL){
+                        job->inputMode = currProgCMD.arg;
+                        break;
+                    }
+#endif
+                    
                     //is the reuested inputmode getLine?
                     if(currProgCMD.arg == INPUTMODE_GET_LINE){
                         //yes, task might be waiting for a line of data in the inputBuffer, Send an empty one to make sure it won't get stuck doing nothing
@@ -422,19 +872,262 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
                 break;
         }
     }
+#if TERM_MAX_JOBS > 0
     
-    //is a program currently in the foreground
-    if(handle->currProgram != NULL){
-        //does the input mode require any immediate action?
-        if(handle->currProgramInputMode == INPUTMODE_DIRECT){
-            //yes => send data to the queue
-            xStreamBufferSend(handle->currProgram->inputStream, &c, sizeof(c), 0);
+    TERM_reportFinishedJobs(handle);
+#endif
+}
 
-            //check for ctrl+c (kill program)
-            if(c == 0x03){
-                //jep got that, kill it
-                //TODO, maybe also add hardkill if ctrl+c is pressed multiple times
-                ttprintfEcho("^C");
+#if TERM_SERVICE_TASK == 1
+//hands input over to the service task of the terminal. Returns how many bytes of it fit into the buffer before the timeout ran out
+//NOTE: only one task (or ISR) may feed a terminal at a time
+uint32_t TERM_feedInput(TERMINAL_HANDLE * handle, const uint8_t * data, uint32_t length, TickType_t timeout){
+    uint32_t sent = 0;
+    while(sent < length){
+        //a full buffer is only emptied once the service task knows there is something in it, so wake it up before waiting for space
+        uint32_t chunk = xStreamBufferSend(handle->feedStream, &data[sent], length - sent, 0);
+        if(chunk == 0) chunk = xStreamBufferSend(handle->feedStream, &data[sent], length - sent, timeout);
+        if(chunk == 0) break;
+        
+        sent += chunk;
+        xSemaphoreGive(handle->feedSignal);
+    }
+    return sent;
+}
+
+uint32_t TERM_feedInputFromISR(TERMINAL_HANDLE * handle, const uint8_t * data, uint32_t length, BaseType_t * higherPriorityTaskWoken){
+    uint32_t sent = xStreamBufferSendFromISR(handle->feedStream, data, length, higherPriorityTaskWoken);
+    if(sent != 0) xSemaphoreGiveFromISR(handle->feedSignal, higherPriorityTaskWoken);
+    return sent;
+}
+
+//waits up to timeout for input or a message from a program and handles it. Returns 0 if nothing arrived
+unsigned TERM_service(TERMINAL_HANDLE * handle, TickType_t timeout){
+    QueueSetMemberHandle_t member = xQueueSelectFromSet(handle->eventSet, timeout);
+    if(member == NULL) return 0;
+    
+    if(member == handle->feedSignal){
+        xSemaphoreTake(handle->feedSignal, 0);
+        
+        //everything that is there now, each block gets its echo sent in one go
+        uint8_t buffer[64];
+        uint32_t length;
+        while((length = xStreamBufferReceive(handle->feedStream, buffer, sizeof(buffer), 0)) != 0){
+            TERM_processBuffer(buffer, length, handle);
+        }
+    }else{
+        //a program returned, wants a line or the foreground. No need to wait for the next key for that.
+        //TERM_processProgramCMDs takes all messages at once, so the set may still report ones that are already gone. That just ends up doing nothing
+        TERM_startOutputBuffering(handle);
+        TERM_processProgramCMDs(handle);
+        TERM_stopOutputBuffering(handle);
+    }
+    
+    return 1;
+}
+
+static void TERM_serviceTask(void * pvData){
+    while(1){
+        TERM_service((TERMINAL_HANDLE *) pvData, portMAX_DELAY);
+    }
+}
+#endif
+
+//bytes that can be handed to a program in INPUTMODE_DIRECT without going through TERM_handleInput
+#if TERM_MAX_JOBS > 0 && TERM_JOB_STOP_KEY != 0
+#define TERM_isDirectInput(c) ((c) != 0x1b && (c) != 0x03 && (c) != TERM_JOB_STOP_KEY)
+#else
+#define TERM_isDirectInput(c) ((c) != 0x1b && (c) != 0x03)
+#endif
+
+//sends keys to the program in the foreground. Only whole keys are sent, if the stream doesn't have enough space for all of them the rest is dropped
+static void TERM_sendKeysToProgram(TERMINAL_HANDLE * handle, uint16_t * keys, uint32_t count){
+    uint32_t space = xStreamBufferSpacesAvailable(handle->currProgram->inputStream) / sizeof(uint16_t);
+    if(count > space) count = space;
+    if(count == 0) return;
+    xStreamBufferSend(handle->currProgram->inputStream, keys, count * sizeof(uint16_t), 0);
+}
+
+//widens a run of plain bytes to the 16 bit keys the stream carries and sends them to the program in blocks
+static void TERM_forwardBytesToProgram(TERMINAL_HANDLE * handle, uint8_t * data, uint32_t length){
+    uint16_t keys[32];
+    uint32_t currPos = 0;
+    uint32_t blockLength;
+    
+    while(currPos < length){
+        for(blockLength = 0; blockLength < 32 && currPos < length; blockLength++) keys[blockLength] = data[currPos++];
+        TERM_sendKeysToProgram(handle, keys, blockLength);
+    }
+}
+#endif
+
+uint8_t TERM_processBuffer(uint8_t * data, uint16_t length, TERMINAL_HANDLE * handle){
+    uint16_t currPos = 0;
+    
+    //collect all echo generated by this block of data and send it with a single print call at the end
+    TERM_startOutputBuffering(handle);
+    
+    uint16_t keys[TERM_VT100_MAX_KEYS_PER_BYTE];
+    uint32_t keyCount;
+    uint32_t currKey;
+    
+    uint16_t runStart;
+    
+#if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
+    //check if we have any program commands to process (that could be enterForeground, exitForeground, return etc.)
+    TERM_processProgramCMDs(handle);
+#endif
+    
+    for(;currPos < length; currPos++){
+#if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
+        //does the program in the foreground want raw input? Then send it everything up to the next escape sequence, ctrl+c or the job stop key (which all need the handler) in one go
+        if(handle->currProgram != NULL && handle->currProgramInputMode == INPUTMODE_DIRECT && TERM_isDirectInput(data[currPos]) && TERM_isVT100DecoderIdle(&handle->vt100Decoder)){
+            runStart = currPos;
+            while(currPos < length && TERM_isDirectInput(data[currPos])) currPos++;
+            TERM_forwardBytesToProgram(handle, &data[runStart], currPos - runStart);
+            
+            if(currPos == length) break;
+        }
+#endif
+        
+        //are we inside of a bracketed paste? If so hand over everything up to the next escape sequence (possibly the end marker) as one block
+        if(handle->pasteActive && data[currPos] != 0x1b && TERM_isVT100DecoderIdle(&handle->vt100Decoder)){
+            runStart = currPos;
+            while(currPos < length && data[currPos] != 0x1b) currPos++;
+            TERM_handlePaste(&data[runStart], currPos - runStart, handle);
+            
+            if(currPos == length) break;
+        }
+        
+        //run the byte through the escape sequence decoder and handle whatever keys it completes
+        keyCount = TERM_decodeVT100(&handle->vt100Decoder, data[currPos], keys);
+        for(currKey = 0; currKey < keyCount; currKey++){
+            if(keys[currKey] == _VT100_PASTE_START){
+                handle->pasteActive = 1;
+            }else if(keys[currKey] == _VT100_PASTE_END){
+                handle->pasteActive = 0;
+            }else if(keys[currKey] == _VT100_CURSOR_REPORT){
+                //answer to TERM_probeSize. The cursor couldn't go any further than the bottom right corner, so its position is the terminal size
+                if(handle->vt100Decoder.params[0] != 0) handle->termRows = handle->vt100Decoder.params[0];
+                if(handle->vt100Decoder.params[1] != 0) handle->termColumns = handle->vt100Decoder.params[1];
+            }
+            TERM_handleInput(keys[currKey], handle);
+        }
+    }
+    
+    TERM_stopOutputBuffering(handle);
+}
+
+//inserts a block of pasted text at once instead of going through TERM_handleInput for every single character (which would shift and redraw the line every time)
+static void TERM_handlePaste(uint8_t * data, uint32_t length, TERMINAL_HANDLE * handle){
+#if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
+    //is a program in the foreground that wants the raw input?
+    if(handle->currProgram != NULL){
+        if(handle->currProgramInputMode == INPUTMODE_DIRECT){
+            //yes, normally TERM_processBuffer already sent it there. Just in case the input mode changed half way through a block
+            TERM_forwardBytesToProgram(handle, data, length);
+            return;
+        }else if(handle->currProgramInputMode == INPUTMODE_NONE){
+            return;
+        }
+    }
+#endif
+    
+    TERM_checkForCopy(handle, TERM_CHECK_COMP_AND_HIST);
+    
+    //copy the data in front of the cursor. Pasted line breaks and other control chars become spaces, we never want a paste to execute anything
+    uint32_t startPosition = handle->currBufferPosition;
+    uint32_t inserted = TERM_lineInsert(handle, (char *) data, length);
+    if(inserted < length) TERM_printDebug(handle, "ERROR: input buffer overflow!\r\n");
+    if(inserted == 0) return;
+    
+    char * dst = &handle->inputBuffer[startPosition];
+    uint32_t currPos = 0;
+    for(;currPos < inserted; currPos++){
+        if(dst[currPos] < 32 || dst[currPos] == 0x7f) dst[currPos] = ' ';
+    }
+    
+    //print the pasted data and redraw whatever was behind the cursor
+    if(handle->currEchoEnabled){
+        TermIovec echo[] = {
+            {.data = dst, .length = inserted},
+            {.data = TERM_lineGetTail(handle), .length = handle->currBufferLength - handle->currBufferPosition}
+        };
+        TERM_writev(handle, echo, 2);
+    }
+    if(handle->currBufferPosition != handle->currBufferLength) TERM_sendVT100Code(handle, _VT100_CURSOR_BACK_BY, handle->currBufferLength - handle->currBufferPosition);
+}
+
+unsigned isACIILetter(char c){
+    return (c > 64 && c < 91) || (c > 96 && c < 122) || c == '~';
+}
+
+void TERM_printBootMessage(TERMINAL_HANDLE * handle){
+    TERM_sendVT100Code(handle, _VT100_RESET, 0); TERM_sendVT100Code(handle, _VT100_CURSOR_POS1, 0); TERM_sendVT100Code(handle, _VT100_WRAP_OFF, 0);
+    //have the terminal mark pasted text, so we can insert it in one go (see TERM_handlePaste)
+    TERM_sendVT100Code(handle, _VT100_BRACKETED_PASTE_ON, 0);
+    TERM_probeSize(handle);
+    ttprintfEcho("\r\n\n\n%s\r\n", TERM_startupText);
+    
+    if(handle->currBufferLength == 0){
+        TERM_printPrompt(handle, "\r\n\r\n");
+    }else{
+        TERM_printPrompt(handle, "\r\n\r\n");
+        TERM_linePrint(handle);
+    }
+}
+
+//asks the terminal how big it is: move the cursor way past the bottom right corner (the terminal stops it at the edge) and request a cursor position report.
+//The answer arrives through TERM_processBuffer later on, programs in the foreground get a _VT100_CURSOR_REPORT key once termRows/termColumns are updated
+void TERM_probeSize(TERMINAL_HANDLE * handle){
+    //no point in asking if nobody is listening to our output
+    if(!handle->echoEnabled) return;
+    
+    TERM_expectVT100CursorReport(&handle->vt100Decoder);
+    ttwriteLiteral("\x1b" "7" "\x1b[999;999H\x1b[6n\x1b" "8");
+}
+
+uint8_t TERM_defaultErrorPrinter(TERMINAL_HANDLE * handle, uint32_t retCode){
+    switch(retCode){
+        case TERM_CMD_EXIT_SUCCESS:
+            TERM_printPrompt(handle, "\r\n");
+            break;
+
+        case TERM_CMD_EXIT_ERROR:
+            ttprintfEcho("\r\nTask returned with error code %d", retCode);
+            TERM_printPrompt(handle, "\r\n");
+            break;
+
+        case TERM_CMD_EXIT_NOT_FOUND:
+            ttprintfEcho("\"%s\" is not a valid command. Type \"help\" to see a list of available ones", TERM_lineGetString(handle));
+            TERM_printPrompt(handle, "\r\n");
+            break;
+    }
+    return 0;
+}
+
+static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
+#if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
+    //is a program currently in the foreground
+    if(handle->currProgram != NULL){
+#if TERM_MAX_JOBS > 0 && TERM_JOB_STOP_KEY != 0
+        //does the user want the terminal back?
+        if(c == TERM_JOB_STOP_KEY){
+            TERM_stopForegroundProgram(handle);
+            return 1;
+        }
+        
+#endif
+        //does the input mode require any immediate action?
+        if(handle->currProgramInputMode == INPUTMODE_DIRECT){
+            //yes => send data to the queue
+            TERM_sendKeysToProgram(handle, &c, 1);
+
+            //check for ctrl+c (kill program)
+            if(c == 0x03){
+                //jep got that, kill it
+                //TODO, maybe also add hardkill if ctrl+c is pressed multiple times
+                ttprintfEcho("^C");
             }
             return 1;
         }else if(handle->currProgramInputMode == INPUTMODE_NONE){
@@ -444,6 +1137,12 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
     }
 #endif
     
+    //programs get to see the modifier keys, the line editor doesn't care about them
+    if(c != _VT100_INVALID) c &= ~_VT100_MOD_MASK;
+    
+    //only two tabs right after each other list the completion candidates
+    if(c != '\t') handle->autocompleteListPending = 0;
+    
     switch(c){
         case '\r':      //enter
             //are we currently looking at a history entry?
@@ -452,7 +1151,7 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
             //is there any data in the buffer?
             if(handle->currBufferLength != 0){
                 //send newline
-                ttprintfEcho("\r\n");
+                ttwriteLiteralEcho("\r\n");
                 uint8_t retCode = TERM_CMD_EXIT_ERROR;
                 
 
@@ -464,7 +1163,7 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
                     //what action does the program want us to do?
                     if(handle->currProgramInputMode == INPUTMODE_GET_LINE){
                         //send data to the stream
-                        xStreamBufferSend(handle->currProgram->inputStream, handle->inputBuffer, sizeof(char) * handle->currBufferLength, 0);
+                        xStreamBufferSend(handle->currProgram->inputStream, TERM_lineGetString(handle), sizeof(char) * handle->currBufferLength, 0);
                         xStreamBufferSend(handle->currProgram->inputStream, "\n", sizeof(char), 0);
                     }
                     
@@ -474,6 +1173,10 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
 #endif
                 }else{
                 //copy command into history
+#if TERM_STATIC_ALLOCATION == 1
+                    //every entry has room for a full line, the old command just gets overwritten
+                    memcpy(handle->historyBuffer[handle->currHistoryWritePosition], TERM_lineGetString(handle), handle->currBufferLength + 1);
+#else
                     //is the next position free?
                     if(handle->historyBuffer[handle->currHistoryWritePosition] != 0){
                         //no it already has a command in it, free that
@@ -483,7 +1186,8 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
 
                     //allocate memory for the entry and copy the command
                     handle->historyBuffer[handle->currHistoryWritePosition] = TERM_MALLOC(handle->currBufferLength + 1);
-                    memcpy(handle->historyBuffer[handle->currHistoryWritePosition], handle->inputBuffer, handle->currBufferLength + 1);
+                    if(handle->historyBuffer[handle->currHistoryWritePosition] != 0) memcpy(handle->historyBuffer[handle->currHistoryWritePosition], TERM_lineGetString(handle), handle->currBufferLength + 1);
+#endif
 
                     //increment history pointer
                     if(++handle->currHistoryWritePosition >= TERM_HISTORYSIZE) handle->currHistoryWritePosition = 0;
@@ -492,13 +1196,11 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
                     handle->currHistoryReadPosition = handle->currHistoryWritePosition;
 
                 //interpret and run the command
-                    retCode = TERM_interpretCMD(handle->inputBuffer, handle->currBufferLength, handle);
+                    retCode = TERM_interpretCMD(TERM_lineGetString(handle), handle->currBufferLength, handle);
                     (*handle->errorPrinter)(handle, retCode);
                 }
 
-                handle->currBufferPosition = 0;
-                handle->currBufferLength = 0;
-                handle->inputBuffer[handle->currBufferPosition] = 0;
+                TERM_lineClear(handle);
                 
                 return retCode;
             }else{
@@ -511,7 +1213,7 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
 				if(0){
 #endif
                 }else{
-                    ttprintfEcho("\r\n%s@%s>", handle->currUserName, TERM_DEVICE_NAME);
+                    TERM_printPrompt(handle, "\r\n");
                 }
             }       
             break;
@@ -530,11 +1232,10 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
 			if(0){
 #endif
             }else{
-                handle->currBufferPosition = 0;
-                handle->currBufferLength = 0;
-                memset(handle->inputBuffer, 0, TERM_INPUTBUFFER_SIZE);
-                handle->currBufferPosition = 0;
-                ttprintfEcho("\r\n%s@%s>", handle->currUserName, TERM_DEVICE_NAME);
+                //drop whatever completion was being shown along with the line
+                TERM_endCompletion(handle);
+                TERM_lineClear(handle);
+                TERM_printPrompt(handle, "\r\n");
             }
             
             break;
@@ -544,30 +1245,30 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
             TERM_checkForCopy(handle, TERM_CHECK_COMP_AND_HIST);
             if(handle->currBufferPosition == 0) break;
             
-            if(handle->inputBuffer[handle->currBufferPosition] != 0){      //check if we are at the end of our command
-                //we are somewhere in the middle -> move back existing characters
-                strsft(handle->inputBuffer, handle->currBufferPosition - 1, -1);    
-                ttprintfEcho("\x08");   
-                TERM_sendVT100Code(handle, _VT100_ERASE_LINE_END, 0);
-                ttprintfEcho("%s", &handle->inputBuffer[handle->currBufferPosition - 1]);
-                TERM_sendVT100Code(handle, _VT100_CURSOR_BACK_BY, handle->currBufferLength - handle->currBufferPosition);
-                handle->currBufferPosition --;
-                handle->currBufferLength --;
+            if(handle->currBufferPosition != handle->currBufferLength){      //check if we are at the end of our command
+                //we are somewhere in the middle -> have the terminal shift the rest of the line back for us
+                TERM_lineDeleteBack(handle);
+                ttwriteLiteralEcho("\x08");   
+                TERM_sendVT100Code(handle, _VT100_DELETE_CHAR, 1);
             }else{
                 //we are somewhere at the end -> just delete the current one
-                handle->inputBuffer[--handle->currBufferPosition] = 0;
-                ttprintfEcho("\x08 \x08");           
-                handle->currBufferLength --;
+                TERM_lineDeleteBack(handle);
+                ttwriteLiteralEcho("\x08 \x08");           
             }
             break;
             
+        case _VT100_KEY_DEL:
+            TERM_checkForCopy(handle, TERM_CHECK_COMP_AND_HIST);
+            if(TERM_lineDeleteForward(handle)) TERM_sendVT100Code(handle, _VT100_DELETE_CHAR, 1);
+            break;
+            
         case _VT100_KEY_END:
             TERM_checkForCopy(handle, TERM_CHECK_COMP_AND_HIST); //is the user browsing the history right now? if so copy whatever ehs looking at to the entry buffer
             
             if(handle->currBufferLength > handle->currBufferPosition){
                 //move the cursor to the right position
                 TERM_sendVT100Code(handle, _VT100_CURSOR_FORWARD_BY, handle->currBufferLength - handle->currBufferPosition);
-                handle->currBufferPosition = handle->currBufferLength;
+                TERM_lineSetCursor(handle, handle->currBufferLength);
             }
             break;
             
@@ -577,7 +1278,7 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
             if(handle->currBufferPosition > 0){
                 //move the cursor to the right position
                 TERM_sendVT100Code(handle, _VT100_CURSOR_BACK_BY, handle->currBufferPosition);
-                handle->currBufferPosition = 0;
+                TERM_lineSetCursor(handle, 0);
             }
             break;
             
@@ -585,7 +1286,7 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
             TERM_checkForCopy(handle, TERM_CHECK_COMP_AND_HIST);
             
             if(handle->currBufferPosition < handle->currBufferLength){
-                handle->currBufferPosition ++;
+                TERM_lineSetCursor(handle, handle->currBufferPosition + 1);
                 TERM_sendVT100Code(handle, _VT100_CURSOR_FORWARD, 0);
             }
             break;
@@ -594,7 +1295,7 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
             TERM_checkForCopy(handle, TERM_CHECK_COMP_AND_HIST);
             
             if(handle->currBufferPosition > 0){
-                handle->currBufferPosition --;
+                TERM_lineSetCursor(handle, handle->currBufferPosition - 1);
                 TERM_sendVT100Code(handle, _VT100_CURSOR_BACK, 0);
             }
             break;
@@ -612,19 +1313,17 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
                 do{
                     if(--handle->currHistoryReadPosition >= TERM_HISTORYSIZE) handle->currHistoryReadPosition = TERM_HISTORYSIZE - 1;
 
-                    if(handle->historyBuffer[handle->currHistoryReadPosition] != 0){
+                    if(TERM_hasHistoryEntry(handle, handle->currHistoryReadPosition)){
                         break;
                     }
                 }while(handle->currHistoryReadPosition != handle->currHistoryWritePosition);
 
                 //print out the command at the current history read position
                 if(handle->currHistoryReadPosition == handle->currHistoryWritePosition){
-                    ttprintfEcho("\x07");   //rings a bell doesn't it?                                                      
-                    TERM_sendVT100Code(handle, _VT100_ERASE_LINE, 0);
-                    ttprintfEcho("\r%s@%s>%s", handle->currUserName, TERM_DEVICE_NAME, handle->inputBuffer);
+                    ttwriteLiteralEcho("\x07");   //rings a bell doesn't it?                                                      
+                    TERM_lineShowInput(handle);
                 }else{
-                    TERM_sendVT100Code(handle, _VT100_ERASE_LINE, 0);
-                    ttprintfEcho("\r%s@%s>%s", handle->currUserName, TERM_DEVICE_NAME, handle->historyBuffer[handle->currHistoryReadPosition]);
+                    TERM_lineShow(handle, "", 0, handle->historyBuffer[handle->currHistoryReadPosition], 0);
                 }
             }
                 
@@ -643,19 +1342,17 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
                 while(handle->currHistoryReadPosition != handle->currHistoryWritePosition){
                     if(++handle->currHistoryReadPosition >= TERM_HISTORYSIZE) handle->currHistoryReadPosition = 0;
 
-                    if(handle->historyBuffer[handle->currHistoryReadPosition] != 0){
+                    if(TERM_hasHistoryEntry(handle, handle->currHistoryReadPosition)){
                         break;
                     }
                 }
 
                 //print out the command at the current history read position
                 if(handle->currHistoryReadPosition == handle->currHistoryWritePosition){
-                    ttprintfEcho("\x07");   //rings a bell doesn't it?                                                      
-                    TERM_sendVT100Code(handle, _VT100_ERASE_LINE, 0);
-                    ttprintfEcho("\r%s@%s>%s", handle->currUserName, TERM_DEVICE_NAME, handle->inputBuffer);
+                    ttwriteLiteralEcho("\x07");   //rings a bell doesn't it?                                                      
+                    TERM_lineShowInput(handle);
                 }else{
-                    TERM_sendVT100Code(handle, _VT100_ERASE_LINE, 0);
-                    ttprintfEcho("\r%s@%s>%s", handle->currUserName, TERM_DEVICE_NAME, handle->historyBuffer[handle->currHistoryReadPosition]);
+                    TERM_lineShow(handle, "", 0, handle->historyBuffer[handle->currHistoryReadPosition], 0);
                 }
             }
             
@@ -672,27 +1369,40 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
 			if(1){
 #endif
             
-                if(handle->autocompleteBuffer == NULL){ 
+                if(!handle->autocompleteActive){ 
                     TERM_doAutoComplete(handle);
+                    
+                    //like bash: if all candidates continue the same way past what was typed, fill that in first
+                    if(TERM_completeCommonPrefix(handle)){
+                        handle->autocompleteListPending = (TERM_TAB_LIST_CANDIDATES == 1);
+                        break;
+                    }
+                    
+#if TERM_TAB_LIST_CANDIDATES == 1
+                    //more than one way to go on from here: the first tab only rings the bell, the one after it shows all of them at once
+                    if(handle->autocompleteBufferLength > 1){
+                        if(handle->autocompleteListPending){
+                            TERM_listCompletions(handle);
+                        }else{
+                            ttwriteLiteralEcho("\x07");
+                        }
+                        handle->autocompleteListPending = 1;
+                        
+                        //nothing to cycle through, the next tab gets the candidates again (narrowed down if more was typed)
+                        TERM_endCompletion(handle);
+                        break;
+                    }
+#endif
                 }
 
                 if(++handle->currAutocompleteCount > handle->autocompleteBufferLength) handle->currAutocompleteCount = 0;
 
                 if(handle->currAutocompleteCount == 0){
-                    ttprintfEcho("\x07");
-                    TERM_sendVT100Code(handle, _VT100_ERASE_LINE, 0);
-                    ttprintfEcho("\r%s@%s>%s", handle->currUserName, TERM_DEVICE_NAME, handle->inputBuffer);
+                    ttwriteLiteralEcho("\x07");
+                    TERM_lineShowInput(handle);
                 }else{
-                    TERM_sendVT100Code(handle, _VT100_ERASE_LINE, 0);
-                    unsigned printQuotationMarks = strchr(handle->autocompleteBuffer[handle->currAutocompleteCount - 1], ' ') != 0;
-                    volatile TERMINAL_HANDLE * temp = handle;
-
-                    //workaround for inconsistent printf behaviour when using %.*s with length 0
-                    if(handle->autocompleteStart == 0){
-                        ttprintfEcho(printQuotationMarks ? "\r%s@%s>\"%s\"" : "\r%s@%s>%s", handle->currUserName, TERM_DEVICE_NAME, handle->autocompleteBuffer[handle->currAutocompleteCount - 1]);
-                    }else{
-                        ttprintfEcho(printQuotationMarks ? "\r%s@%s>%.*s\"%s\"" : "\r%s@%s>%.*s%s", handle->currUserName, TERM_DEVICE_NAME, handle->autocompleteStart, handle->inputBuffer, handle->autocompleteBuffer[handle->currAutocompleteCount - 1]);
-                    }
+                    const char * completion = TERM_getCompletion(handle, handle->currAutocompleteCount - 1);
+                    TERM_lineShow(handle, TERM_lineGetString(handle), handle->autocompleteStart, completion, strchr(completion, ' ') != 0);
                 }
             }
             break;
@@ -707,20 +1417,18 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
 #else
 			if(1){
 #endif
-                if(handle->autocompleteBuffer == NULL){ 
+                if(!handle->autocompleteActive){ 
                     TERM_doAutoComplete(handle);
                 }
 
                 if(--handle->currAutocompleteCount > handle->autocompleteBufferLength - 1) handle->currAutocompleteCount = handle->autocompleteBufferLength - 1;
 
                 if(handle->currAutocompleteCount == 0){
-                    ttprintfEcho("\x07");
-                    TERM_sendVT100Code(handle, _VT100_ERASE_LINE, 0);
-                    ttprintfEcho("\r%s@%s>%s", handle->currUserName, TERM_DEVICE_NAME, handle->inputBuffer);
+                    ttwriteLiteralEcho("\x07");
+                    TERM_lineShowInput(handle);
                 }else{
-                    TERM_sendVT100Code(handle, _VT100_ERASE_LINE, 0);
-                    unsigned printQuotationMarks = strchr(handle->autocompleteBuffer[handle->currAutocompleteCount - 1], ' ') != 0;
-                    ttprintfEcho(printQuotationMarks ? "\r%s@%s>%.*s\"%s\"" : "\r%s@%s>%.*s%s", handle->currUserName, TERM_DEVICE_NAME, handle->autocompleteStart, handle->inputBuffer, handle->autocompleteBuffer[handle->currAutocompleteCount - 1]);
+                    const char * completion = TERM_getCompletion(handle, handle->currAutocompleteCount - 1);
+                    TERM_lineShow(handle, TERM_lineGetString(handle), handle->autocompleteStart, completion, strchr(completion, ' ') != 0);
                 }
             }
             break;
@@ -740,6 +1448,15 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
             }
             break;
            
+        case _VT100_PASTE_START:
+        case _VT100_PASTE_END:
+            //the paste itself is handled by TERM_handlePaste
+            break;
+            
+        case _VT100_CURSOR_REPORT:
+            //already dealt with in TERM_processBuffer
+            break;
+           
         case 32 ... 126: //normal letter
             TERM_checkForCopy(handle, TERM_CHECK_COMP_AND_HIST);
             
@@ -747,24 +1464,13 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
             
             //check if there is still space in the buffer
             if(handle->currBufferLength+1 < TERM_INPUTBUFFER_SIZE){
-                if(handle->inputBuffer[handle->currBufferPosition] != 0){      //check if we are at the end of our command
-                    strsft(handle->inputBuffer, handle->currBufferPosition, 1);   
-                    handle->inputBuffer[handle->currBufferPosition] = c; 
-                    TERM_sendVT100Code(handle, _VT100_ERASE_LINE_END, 0);
-                    ttprintfEcho("%s", &handle->inputBuffer[handle->currBufferPosition]);
-                    TERM_sendVT100Code(handle, _VT100_CURSOR_BACK_BY, handle->currBufferLength - handle->currBufferPosition);
-                    handle->currBufferLength ++;
-                    handle->currBufferPosition ++;
-
-                }else{
-                    //we are at the end -> just delete the current character
-
-                    //check if we still have space in the buffer
-                    handle->inputBuffer[handle->currBufferPosition++] = c;
-                    handle->inputBuffer[handle->currBufferPosition] = 0;
-                    handle->currBufferLength ++;
-                    ttprintfEcho("%c", c);
+                char newChar = c;
+                if(handle->currBufferPosition != handle->currBufferLength){      //check if we are at the end of our command
+                    //we are somewhere in the middle -> have the terminal make room for the new character
+                    TERM_sendVT100Code(handle, _VT100_INSERT_CHAR, 1);
                 }
+                TERM_lineInsert(handle, &newChar, 1);
+                ttwriteEcho(&newChar, 1);
             }else{
                 TERM_printDebug(handle, "ERROR: input buffer overflow!\r\n");
             }
@@ -811,26 +1517,27 @@ static uint8_t TERM_handleInput(uint16_t c, TERMINAL_HANDLE * handle){
 }
 
 void TERM_checkForCopy(TERMINAL_HANDLE * handle, COPYCHECK_MODE mode){
-    if((mode & TERM_CHECK_COMP) && handle->autocompleteBuffer != NULL){ 
+    if((mode & TERM_CHECK_COMP) && handle->autocompleteActive){ 
         if(handle->currAutocompleteCount != 0){
-            char * dst = (char *) ((uint32_t) handle->inputBuffer + handle->autocompleteStart);
-            if(strchr(handle->autocompleteBuffer[handle->currAutocompleteCount - 1], ' ') != 0){
-                sprintf(dst, "\"%s\"", handle->autocompleteBuffer[handle->currAutocompleteCount - 1]);
+            //replace everything from the start of the completion onwards and put the cursor at the end
+            TERM_lineGetString(handle);
+            TERM_lineSetCursor(handle, handle->autocompleteStart);
+            handle->currBufferLength = handle->currBufferPosition;
+            
+            const char * completion = TERM_getCompletion(handle, handle->currAutocompleteCount - 1);
+            if(strchr(completion, ' ') != 0){
+                TERM_lineInsert(handle, "\"", 1);
+                TERM_lineInsert(handle, completion, strlen(completion));
+                TERM_lineInsert(handle, "\"", 1);
             }else{
-                strcpy(dst, handle->autocompleteBuffer[handle->currAutocompleteCount - 1]);
+                TERM_lineInsert(handle, completion, strlen(completion));
             }
-            handle->currBufferLength = strlen(handle->inputBuffer);
-            handle->currBufferPosition = handle->currBufferLength;
-            handle->inputBuffer[handle->currBufferPosition] = 0;
         }
-        TERM_FREE(handle->autocompleteBuffer);
-        handle->autocompleteBuffer = NULL;
+        TERM_endCompletion(handle);
     }
     
     if((mode & TERM_CHECK_HIST) && handle->currHistoryWritePosition != handle->currHistoryReadPosition){
-        strcpy(handle->inputBuffer, handle->historyBuffer[handle->currHistoryReadPosition]);
-        handle->currBufferLength = strlen(handle->inputBuffer);
-        handle->currBufferPosition = handle->currBufferLength;
+        TERM_lineSetString(handle, handle->historyBuffer[handle->currHistoryReadPosition]);
         handle->currHistoryReadPosition = handle->currHistoryWritePosition;
     }
 }
@@ -870,27 +1577,214 @@ void strsft(char * src, int32_t startByte, int32_t offset){
 TermCommandDescriptor * TERM_findCMD(TERMINAL_HANDLE * handle){
     uint16_t cmdLength = handle->currBufferLength;
     
-    char * firstSpace = strchr(handle->inputBuffer, ' ');
+    char * firstSpace = strchr(TERM_lineGetString(handle), ' ');
     if(firstSpace != 0){
-        cmdLength = (uint16_t) ((uint32_t) firstSpace - (uint32_t) handle->inputBuffer);
+        cmdLength = (uint16_t) (firstSpace - handle->inputBuffer);
     }
     
     return TERM_findCMDFromName(handle->cmdListHead, handle->inputBuffer, cmdLength);
 }
 
-TermCommandDescriptor * TERM_findCMDFromName(TermCommandDescriptor * list, char * name, uint32_t length){
+//FNV-1a hash of a command name
+uint32_t TERM_hashCommand(const char * name, uint32_t length){
+    uint32_t hash = 2166136261u;
+    uint32_t currPos = 0;
+    for(;currPos < length; currPos++){
+        hash ^= (uint8_t) name[currPos];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+//compares name (not terminated) to a command the same way strcmp would
+static int32_t TERM_compareCommandName(const char * name, uint32_t length, const TermCommandDescriptor * cmd){
+    int32_t result = strncmp(name, cmd->command, length);
+    if(result != 0) return result;
+    return (cmd->commandLength > length) ? -1 : 0;
+}
+
+#if TERM_PERFECT_HASH == 1
+//slot of a name in the perfect hash table. Has to match what tools/tterm_phash.py does
+static uint32_t TERM_perfectHash(const char * name, uint32_t length){
+    //one FNV-1a pass over the name, the second hash is just the first one mixed up a bit more
+    uint32_t hash = TERM_PHASH_SEED;
     uint32_t currPos = 0;
-    TermCommandDescriptor * currCmd = list->nextCmd;
+    for(;currPos < length; currPos++){
+        hash ^= (uint8_t) name[currPos];
+        hash *= 16777619u;
+    }
+    
+    uint32_t mixed = hash ^ (hash >> 16);
+    mixed *= 0x85ebca6bu;
+    mixed ^= mixed >> 13;
+    mixed *= 0xc2b2ae35u;
+    mixed ^= mixed >> 16;
+    
+    //the low half of the mixed hash picks the bucket, the high half is multiplied by the displacement of the bucket to move its keys into free slots
+    uint32_t displacement = TERM_phashDisplacements[(mixed & 0xffff) % TERM_PHASH_BUCKETS];
+    return ((hash % TERM_PHASH_COUNT) + (displacement / TERM_PHASH_COUNT) * ((mixed >> 16) % TERM_PHASH_COUNT) + (displacement % TERM_PHASH_COUNT)) % TERM_PHASH_COUNT;
+}
+
+//the table is only usable if it was generated for exactly the commands the linker put into flash. Checked once at the first lookup
+static unsigned TERM_isPerfectHashValid(){
+    static int32_t valid = -1;
+    if(valid != -1) return valid;
+    
+    valid = 0;
+    if(__tterm_cmd_end - __tterm_cmd_start != TERM_PHASH_COUNT) return 0;
+    
+    uint32_t currCmd = 0;
+    for(;currCmd < TERM_PHASH_COUNT; currCmd++){
+        if(TERM_phashIndex[TERM_perfectHash(__tterm_cmd_start[currCmd].command, __tterm_cmd_start[currCmd].commandLength)] != currCmd) return 0;
+    }
+    valid = 1;
+    return 1;
+}
+#endif
+
+//finds a command in the static table of a list. Binary search unless there is a perfect hash table for it
+static const TermCommandDescriptor * TERM_findStaticCMD(TermCommandDescriptor * list, char * name, uint32_t length){
+    if(list->index == NULL) return NULL;
+    const TermCommandDescriptor * first = list->index->staticCommands;
+    const TermCommandDescriptor * last = list->index->staticCommandsEnd;
+    if(first == NULL) return NULL;
+    
+#if TERM_PERFECT_HASH == 1
+    if(first == __tterm_cmd_start && TERM_isPerfectHashValid()){
+        //one hash and one compare
+        const TermCommandDescriptor * cmd = &first[TERM_phashIndex[TERM_perfectHash(name, length)]];
+        return (TERM_compareCommandName(name, length, cmd) == 0) ? cmd : NULL;
+    }
+#endif
+    
+    while(first < last){
+        const TermCommandDescriptor * middle = first + (last - first) / 2;
+        int32_t result = TERM_compareCommandName(name, length, middle);
+        
+        if(result == 0) return middle;
+        if(result < 0){
+            last = middle;
+        }else{
+            first = middle + 1;
+        }
+    }
+    return NULL;
+}
+
+TermCommandDescriptor * TERM_findCMDFromName(TermCommandDescriptor * list, char * name, uint32_t length){
+    TermCommandDescriptor * currCmd;
     
+    if(list->index != NULL && list->index->hashTable != NULL){
+        currCmd = list->index->hashTable[TERM_hashCommand(name, length) & (list->index->hashTableSize - 1)];
+        while(currCmd != NULL){
+            if(currCmd->commandLength == length && strncmp(name, currCmd->command, length) == 0) return currCmd;
+            currCmd = currCmd->nextHash;
+        }
+        return (TermCommandDescriptor *) TERM_findStaticCMD(list, name, length);
+    }
+    
+    //no hash index (allocating it failed), go through the list
+    uint32_t currPos = 0;
+    currCmd = list->nextCmd;
     for(;currPos < list->commandLength; currPos++){
         if(currCmd->commandLength == length && strncmp(name, currCmd->command, length) == 0) return currCmd;
         currCmd = currCmd->nextCmd;
     }
     
-    return NULL;
+    return (TermCommandDescriptor *) TERM_findStaticCMD(list, name, length);
 }
 
 #if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
+#if TERM_CMD_STATS == 1
+//shared by all terminals, commands are found by the hash of their name with linear probing
+static TermCommandStats TERM_commandStats[TERM_CMD_STATS_SIZE];
+
+//the entry of command, a free one for it if add is set and there is none yet. NULL if it isn't there (or the table is full)
+//NOTE: call from a critical section, programs of all terminals record their usage at the same time
+static TermCommandStats * TERM_findCommandStats(const char * command, unsigned add){
+    uint32_t hash = TERM_hashCommand(command, strlen(command));
+    uint32_t currEntry = hash % TERM_CMD_STATS_SIZE;
+    uint32_t probes = 0;
+    for(;probes < TERM_CMD_STATS_SIZE; probes++){
+        TermCommandStats * stats = &TERM_commandStats[currEntry];
+        
+        if(stats->command == NULL){
+            if(!add) return NULL;
+            memset(stats, 0, sizeof(TermCommandStats));
+            stats->command = command;
+            stats->hash = hash;
+            return stats;
+        }
+        
+        if(stats->hash == hash && strcmp(stats->command, command) == 0) return stats;
+        if(++currEntry == TERM_CMD_STATS_SIZE) currEntry = 0;
+    }
+    return NULL;
+}
+
+//called by the program itself once its command returned.
+//A pooled task keeps its high water mark from all commands it ran before, what it says has nothing to do with this command. Those runs are only counted
+static void TERM_recordStackUsage(TermProgram * prog){
+    uint32_t used = 0;
+    if(prog->workerStackSize == 0){
+        uint32_t freeStack = uxTaskGetStackHighWaterMark(NULL);
+        used = (prog->stackSize > freeStack) ? prog->stackSize - freeStack : 0;
+    }
+    
+    taskENTER_CRITICAL();
+    TermCommandStats * stats = TERM_findCommandStats(prog->cmd->command, 1);
+    if(stats != NULL){
+        stats->runs ++;
+        stats->stackSize = prog->stackSize;
+        if(prog->workerStackSize == 0){
+            stats->lastUsed = used;
+            if(used > stats->peak) stats->peak = used;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+//entry index of the table, NULL for free ones and past the end. Meant for saving what was learned, see TERM_setCommandStackPeak
+const TermCommandStats * TERM_getCommandStats(uint32_t index){
+    if(index >= TERM_CMD_STATS_SIZE || TERM_commandStats[index].command == NULL) return NULL;
+    return &TERM_commandStats[index];
+}
+
+//restores a peak measured before (f.E. saved in flash by the last run). command must stay valid, it isn't copied
+void TERM_setCommandStackPeak(const char * command, uint32_t peak){
+    taskENTER_CRITICAL();
+    TermCommandStats * stats = TERM_findCommandStats(command, 1);
+    if(stats != NULL && peak > stats->peak) stats->peak = peak;
+    taskEXIT_CRITICAL();
+}
+
+void TERM_clearCommandStats(){
+    taskENTER_CRITICAL();
+    memset(TERM_commandStats, 0, sizeof(TERM_commandStats));
+    taskEXIT_CRITICAL();
+}
+#endif
+
+#if TERM_STACK_TUNING == 1
+//what the command needed so far plus some margin, stackSize if it hasn't been measured yet
+//With the pool it never gets more than stackSize, a bigger stack than the one it was registered with might not fit any worker
+static uint32_t TERM_getTunedStackSize(TermCommandDescriptor * cmd, uint32_t stackSize){
+    taskENTER_CRITICAL();
+    TermCommandStats * stats = TERM_findCommandStats(cmd->command, 0);
+    uint32_t peak = (stats != NULL) ? stats->peak : 0;
+    taskEXIT_CRITICAL();
+    
+    if(peak == 0) return stackSize;
+    
+    peak += TERM_STACK_TUNING_MARGIN;
+    if(peak < configMINIMAL_STACK_SIZE) peak = configMINIMAL_STACK_SIZE;
+#ifdef TERM_WORKER_STACK_CLASSES
+    if(peak > stackSize) peak = stackSize;
+#endif
+    return peak;
+}
+#endif
+
 //sends a program command to the interpreter
 static uint32_t TERM_sendProgCMD(TermProgram * prog, ProgCMDType_t cmd, uint32_t arg, void * data){
     Term_progCMD_t cmdStruct = {.cmd = cmd, .arg = arg, .data = data, .src = prog};
@@ -915,12 +1809,24 @@ static uint32_t TERM_programExitForeground(TermProgram * prog){
 static void TERM_programReturn(TermProgram * prog, uint8_t retCode){
     //print return string and inputbuffer if its not empty
     TERMINAL_HANDLE * handle = prog->handle;
+    unsigned report = 1;
+    
+#if TERM_CMD_STATS == 1
+    TERM_recordStackUsage(prog);
+#endif
     
-    //print exit code if its not success
-    if(retCode != TERM_CMD_EXIT_SUCCESS) ttprintfEcho("\r\n\nCommand \"%s\" exited with code %d\r\n", prog->commandString, retCode);
+#if TERM_MAX_JOBS > 0
+    //the terminal reports jobs in the background itself once it gets PROG_RETURN
+    report = TERM_getBackgroundJob(handle) == NULL;
+#endif
     
-    //also print a new input line
-    ttprintfEcho("\r\n\r\n%s@%s>", handle->currUserName, TERM_DEVICE_NAME);
+    if(report){
+        //print exit code if its not success
+        if(retCode != TERM_CMD_EXIT_SUCCESS) ttprintfEcho("\r\n\nCommand \"%s\" exited with code %d\r\n", prog->commandString, retCode);
+        
+        //also print a new input line
+        TERM_printPrompt(handle, "\r\n\r\n");
+    }
     
     //return terminal (automatically frees memory and exits foreground if needed)
     TERM_sendProgCMD(prog, PROG_RETURN, retCode, 0);
@@ -930,12 +1836,14 @@ void TERM_killProgramm(TERMINAL_HANDLE * handle){
 	//TODO re-implement! Not used at the moment. Function to kill the program currently in the foreground (f.E. due to pressing ctrl+c multiple times)
 }
 
-static void TERM_cmdTask(void * pvData){
-    //prepare data
-    TermProgram *prog = (TermProgram *) pvData;
+//a program gets its tokenized line and the argument pointers in one block, the pointers start at the first aligned position after the line
+#define TERM_ARG_STRINGS_SIZE(dataLength) (((dataLength) + sizeof(char*)) & ~(sizeof(char*) - 1))
+#define TERM_ARG_BLOCK_SIZE(dataLength, maxArgs) (TERM_ARG_STRINGS_SIZE(dataLength) + sizeof(char*) * (maxArgs))
+
+static void TERM_runProgram(TermProgram * prog){
     uint8_t retCode = TERM_CMD_EXIT_ERROR;
     
-    TERM_programEnterForeground(prog);
+    //TERM_interpretCMD already put it into the foreground (unless it is a job in the background)
     
     //start with direct input mode
     TERM_sendProgCMD(prog, PROG_SETINPUTMODE, INPUTMODE_DIRECT, NULL);
@@ -946,12 +1854,137 @@ static void TERM_cmdTask(void * pvData){
     }
               
     TERM_programReturn(prog, retCode);
+}
+
+static void TERM_cmdTask(void * pvData){
+    TERM_runProgram((TermProgram *) pvData);
     
     //remove task
     vTaskDelete(NULL);
     while(1);
 }
 
+#ifdef TERM_WORKER_STACK_CLASSES
+static const uint32_t TERM_workerStackClasses[] = TERM_WORKER_STACK_CLASSES;
+#define TERM_WORKER_COUNT (sizeof(TERM_workerStackClasses) / sizeof(uint32_t) * TERM_WORKERS_PER_CLASS)
+
+static TermProgram * TERM_workers[TERM_WORKER_COUNT];
+static unsigned TERM_workersCreated = 0;
+
+#if TERM_STATIC_ALLOCATION == 1
+//everything the workers need, nothing of it comes from the heap
+static TermProgram TERM_workerPrograms[TERM_WORKER_COUNT];
+static StaticTask_t TERM_workerTaskBuffers[TERM_WORKER_COUNT];
+static StackType_t TERM_workerStacks[TERM_WORKERS_PER_CLASS * TERM_WORKER_STACK_WORDS];
+static StaticStreamBuffer_t TERM_workerStreamBuffers[TERM_WORKER_COUNT];
+static uint8_t TERM_workerStreamStorage[TERM_WORKER_COUNT][TERM_PROG_BUFFER_SIZE + 1];
+static StaticQueue_t TERM_workerQueueBuffers[TERM_WORKER_COUNT];
+static uint8_t TERM_workerQueueStorage[TERM_WORKER_COUNT][TERM_PROG_QUEUE_LENGTH * sizeof(Term_progCMD_t)];
+//char pointers so the argument pointers behind the line are aligned
+static char * TERM_workerArgBlocks[TERM_WORKER_COUNT][TERM_ARG_BLOCK_SIZE(TERM_INPUTBUFFER_SIZE, TERM_MAX_ARGS) / sizeof(char*)];
+static char TERM_workerLineBuffers[TERM_WORKER_COUNT][TERM_INPUTBUFFER_SIZE];
+#endif
+
+//a pooled task runs one command after the other. Its parameter is the program so everything using pvTaskGetCurrentTaskParameters() still finds it
+static void TERM_workerTask(void * pvData){
+    while(1){
+        //wait for TERM_interpretCMD to hand us a command
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        TERM_runProgram((TermProgram *) pvData);
+    }
+}
+
+static void TERM_initWorkers(){
+    if(TERM_workersCreated) return;
+    TERM_workersCreated = 1;
+    
+#if TERM_STATIC_ALLOCATION == 1
+    uint32_t stackOffset = 0;
+#endif
+    
+    uint32_t currWorker = 0;
+    for(;currWorker < TERM_WORKER_COUNT; currWorker++){
+        uint32_t stackSize = TERM_workerStackClasses[currWorker / TERM_WORKERS_PER_CLASS];
+        
+#if TERM_STATIC_ALLOCATION == 1
+        //the stack is the next part of the one all workers share
+        if(stackOffset + stackSize > sizeof(TERM_workerStacks) / sizeof(StackType_t)){
+            //TERM_WORKER_STACK_WORDS is less than all classes together, the remaining workers don't fit
+            configASSERT(0);
+            break;
+        }
+        
+        TermProgram * prog = &TERM_workerPrograms[currWorker];
+        memset(prog, 0, sizeof(TermProgram));
+        
+        prog->inputStream = xStreamBufferCreateStatic(TERM_PROG_BUFFER_SIZE, 1, TERM_workerStreamStorage[currWorker], &TERM_workerStreamBuffers[currWorker]);
+        prog->cmdStream = xQueueCreateStatic(TERM_PROG_QUEUE_LENGTH, sizeof(Term_progCMD_t), TERM_workerQueueStorage[currWorker], &TERM_workerQueueBuffers[currWorker]);
+        prog->commandString = (char *) TERM_workerArgBlocks[currWorker];
+        prog->lineBuffer = TERM_workerLineBuffers[currWorker];
+        prog->workerStackSize = stackSize;
+        prog->stackSize = stackSize;
+        prog->task = xTaskCreateStatic(TERM_workerTask, "TTerm worker", stackSize, (void*) prog, tskIDLE_PRIORITY + 1, &TERM_workerStacks[stackOffset], &TERM_workerTaskBuffers[currWorker]);
+        stackOffset += stackSize;
+#else
+        TermProgram * prog = TERM_MALLOC(sizeof(TermProgram));
+        if(prog == NULL) continue;
+        memset(prog, 0, sizeof(TermProgram));
+        
+        //everything a command needs is allocated once, the argument block has room for the longest line possible
+        prog->inputStream = xStreamBufferCreate(TERM_PROG_BUFFER_SIZE,1);
+        prog->cmdStream = xQueueCreate(TERM_PROG_QUEUE_LENGTH, sizeof(Term_progCMD_t));
+        prog->commandString = TERM_MALLOC(TERM_ARG_BLOCK_SIZE(TERM_INPUTBUFFER_SIZE, TERM_MAX_ARGS));
+        prog->workerStackSize = stackSize;
+        prog->stackSize = stackSize;
+        
+        if(prog->inputStream == NULL || prog->cmdStream == NULL || prog->commandString == NULL
+                || xTaskCreate(TERM_workerTask, "TTerm worker", prog->workerStackSize, (void*) prog, tskIDLE_PRIORITY + 1, &prog->task) != pdPASS){
+            //no space for this one. Commands get a task of their own if there isn't a fitting worker anyway
+            if(prog->inputStream != NULL) vStreamBufferDelete(prog->inputStream);
+            if(prog->cmdStream != NULL) vQueueDelete(prog->cmdStream);
+            if(prog->commandString != NULL) TERM_FREE(prog->commandString);
+            TERM_FREE(prog);
+            continue;
+        }
+#endif
+        
+        TERM_workers[currWorker] = prog;
+    }
+}
+
+//finds a free worker with the smallest stack that still has at least stackSize and marks it as busy. NULL if there is none
+static TermProgram * TERM_claimWorker(uint32_t stackSize){
+    TermProgram * best = NULL;
+    
+    //terminals might be running in different tasks
+    taskENTER_CRITICAL();
+    uint32_t currWorker = 0;
+    for(;currWorker < TERM_WORKER_COUNT; currWorker++){
+        TermProgram * prog = TERM_workers[currWorker];
+        if(prog == NULL || prog->workerBusy || prog->workerStackSize < stackSize) continue;
+        if(best == NULL || prog->workerStackSize < best->workerStackSize) best = prog;
+    }
+    if(best != NULL) best->workerBusy = 1;
+    taskEXIT_CRITICAL();
+    
+    return best;
+}
+
+//called once the worker sent PROG_RETURN, it doesn't touch the program after that
+static void TERM_releaseWorker(TermProgram * prog){
+    //don't leave anything behind for the next command
+    xStreamBufferReset(prog->inputStream);
+    xQueueReset(prog->cmdStream);
+    prog->cmd = NULL;
+    prog->handle = NULL;
+    prog->args = NULL;
+    prog->argCount = 0;
+    prog->inputHandler = NULL;
+    
+    prog->workerBusy = 0;
+}
+#endif
+
 char * TERM_getCommandString(){
     //get prog pointer
     TermProgram *prog = (TermProgram *) pvTaskGetCurrentTaskParameters();
@@ -975,20 +2008,37 @@ uint16_t TERM_getChar(TERMINAL_HANDLE * handle, uint32_t timeout){
     return c;
 }
 
-char * TERM_getLine(TERMINAL_HANDLE * handle, uint32_t timeout, uint32_t controlBehaviour){
+//reads up to maxCount keys at once. Returns how many were read, 0 if nothing arrived before the timeout
+uint32_t TERM_getChars(TERMINAL_HANDLE * handle, uint16_t * buffer, uint32_t maxCount, uint32_t timeout){
     //get prog pointer
     TermProgram *prog = (TermProgram *) pvTaskGetCurrentTaskParameters();
     
-    //empty out the input buffer
+    //the terminal only ever writes whole keys into the stream, so whatever we get here is a multiple of 16bits
+    return xStreamBufferReceive(prog->inputStream, buffer, maxCount * sizeof(uint16_t), timeout) / sizeof(uint16_t);
+}
+
+char * TERM_getLine(TERMINAL_HANDLE * handle, uint32_t timeout, uint32_t controlBehaviour){
+    //get prog pointer
+    TermProgram *prog = (TermProgram *) pvTaskGetCurrentTaskParameters();
+    
+#if TERM_STATIC_ALLOCATION == 1
+    //every worker has a line buffer of its own, so the last line is overwritten by the next call (see TERM_freeLine)
+    char * ret = prog->lineBuffer;
+#else
+    char * ret = TERM_MALLOC(sizeof(char) * TERM_INPUTBUFFER_SIZE);
+    if(ret == NULL) return NULL;
+#endif
+    
+    //empty out the input buffer
     xStreamBufferReset(prog->inputStream);
     
     //request input mode of GETLINE from the interpreter
     if(!TERM_sendProgCMD(prog, PROG_SETINPUTMODE, INPUTMODE_GET_LINE, NULL)){
+        TERM_freeLine(ret);
         return NULL;
     }
     
     //now wait for the string to be read. Terminal will dump the string including a "\n" termination into the input stream
-    char * ret = TERM_MALLOC(sizeof(char) * TERM_INPUTBUFFER_SIZE);
     char c = 0;
     
     //contains the reason we broke the loop. If this is 0 the loop exited normally and the string needs to be returned
@@ -1075,7 +2125,7 @@ char * TERM_getLine(TERMINAL_HANDLE * handle, uint32_t timeout, uint32_t control
         //timeout or other error
         
         //free buffer
-        TERM_FREE(ret);
+        TERM_freeLine(ret);
         
         return NULL;
     }
@@ -1084,156 +2134,276 @@ char * TERM_getLine(TERMINAL_HANDLE * handle, uint32_t timeout, uint32_t control
 }
 #endif
 
-uint8_t TERM_interpretCMD(char * data, uint16_t dataLength, TERMINAL_HANDLE * handle){
-    
-    TermCommandDescriptor * cmd = TERM_findCMD(handle);
+static const char * TERM_getArgsErrorString(uint16_t error){
+    switch(error){
+        case TERM_ARGS_ERROR_STRING_LITERAL:
+            return "unclosed string literal";
+        case TERM_ARGS_ERROR_ESCAPE:
+            return "nothing to escape after \\";
+        case TERM_ARGS_ERROR_TOO_MANY:
+            return "too many arguments";
+        default:
+            return "invalid arguments";
+    }
+}
+
+static void TERM_printArgsError(TERMINAL_HANDLE * handle, uint16_t error, uint16_t errorPosition){
+    ttprintfEcho("\r\nError: %s in command at character %d\r\n", TERM_getArgsErrorString(error), errorPosition + 1);
+}
+
+#if TERM_MAX_JOBS > 0
+//removes a trailing '&' that isn't quoted or escaped (and the spaces in front of it) from the line. Returns 1 if there was one
+static unsigned TERM_stripBackgroundMarker(char * data, uint16_t * dataLength){
+    if(*dataLength == 0 || data[*dataLength - 1] != '&') return 0;
     
-    if(cmd != 0){
-        uint16_t argCount = TERM_countArgs(data, dataLength);
-        if(argCount == TERM_ARGS_ERROR_STRING_LITERAL){
-            ttprintfEcho("\r\nError: unclosed string literal in command\r\n");
-            return TERM_CMD_EXIT_ERROR;
+    //same rules as TERM_tokenizeArgs
+    unsigned quoteMark = 0;
+    unsigned escaped = 0;
+    uint16_t currPos = 0;
+    for(;currPos < *dataLength - 1; currPos++){
+        if(escaped){
+            escaped = 0;
+        }else if(data[currPos] == '\\'){
+            escaped = 1;
+        }else if(data[currPos] == '"'){
+            quoteMark = !quoteMark;
         }
-        
-        char * dataPtr;
+    }
+    if(quoteMark || escaped) return 0;
+    
+    uint16_t length = *dataLength - 1;
+    while(length > 0 && data[length - 1] == ' ') length--;
+    data[length] = 0;
+    *dataLength = length;
+    return 1;
+}
+#endif
 
 #if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
-        //allocate persistent memory for args and copy them
-        dataPtr = TERM_MALLOC(dataLength + 1);
-        dataPtr[dataLength] = 0; //we only need to set the string terminator to 0, the rest will be set by memcpy
-        memcpy(dataPtr, data, dataLength);
-#else
-        //just assign the data pointer to the data
-        dataPtr = data;
+//what TERM_interpretCMD returns once a program is running. A job gets the prompt back right away
+static uint8_t TERM_reportStartedProgram(TERMINAL_HANDLE * handle, TermProgram * program, unsigned background){
+#if TERM_MAX_JOBS > 0
+    if(background){
+        TERM_printJob(handle, TERM_findJob(handle, program), "Running");
+        return TERM_CMD_EXIT_SUCCESS;
+    }
 #endif
-        
-        //seperate the arguments. The pointer returned is going to contain pointers to parts of the dataPrt array
-        char ** args = 0;
-        if(argCount != 0){
-            args = TERM_MALLOC(sizeof(char*) * argCount);
-            TERM_seperateArgs(dataPtr, dataLength, args);
-        }
+    return TERM_CMD_EXIT_PROC_STARTED;
+}
 
-#if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
-        TermProgram * program = TERM_MALLOC(sizeof(TermProgram));
-        memset(program, 0, sizeof(TermProgram));
-        
-        //assign data pointers
+//gives the command a task (a pooled one if possible) and puts it into the foreground, or makes it a job if background is set
+static uint8_t TERM_startProgram(TermCommandDescriptor * cmd, char * data, uint16_t dataLength, TERMINAL_HANDLE * handle, unsigned background){
+    uint16_t errorPosition = 0;
+    uint16_t argCount;
+    
+    //static commands can't have their default stack size filled in by TERM_addCommand
+    uint32_t stackSize = (cmd->stackSize == 0) ? configMINIMAL_STACK_SIZE + 500 : cmd->stackSize;
+    
+#if TERM_STACK_TUNING == 1
+    //size it after what it needed so far instead
+    stackSize = TERM_getTunedStackSize(cmd, stackSize);
+#endif
+    
+    TermProgram * program = NULL;
+    char * dataPtr;
+    char ** args;
+    
+#if TERM_MAX_JOBS > 0
+    //check before anything is taken. Only the terminal adds jobs, so the slot is still free once the program is ready
+    if(background && !TERM_hasFreeJob(handle)){
+        ttprintfEcho("\r\nError: all %d job slots are in use\r\n", TERM_MAX_JOBS);
+        return TERM_CMD_EXIT_ERROR;
+    }
+#endif
+    
+#ifdef TERM_WORKER_STACK_CLASSES
+    //is there a pooled task that can run it? Its program has everything allocated already
+    program = TERM_claimWorker(stackSize);
+    if(program != NULL){
+        dataPtr = program->commandString;
+        args = (char **) &dataPtr[TERM_ARG_STRINGS_SIZE(TERM_INPUTBUFFER_SIZE)];
+        argCount = TERM_tokenizeArgs(data, dataLength, dataPtr, args, TERM_MAX_ARGS, &errorPosition);
+        if(argCount > TERM_MAX_ARGS) TERM_releaseWorker(program);
+    }else
+#endif
+#if TERM_STATIC_ALLOCATION == 1
+    {
+        //without a heap there is no task for it if all fitting workers are busy
+        ttprintfEcho("\r\nError: no free worker with a stack of %d for this command\r\n", stackSize);
+        return TERM_CMD_EXIT_ERROR;
+    }
+#else
+    {
+        //the program needs its own copy of the arguments. The line can't have more of them than every second character starting one
+        uint16_t maxArgs = (dataLength / 2 < TERM_MAX_ARGS) ? dataLength / 2 : TERM_MAX_ARGS;
+
+        dataPtr = TERM_MALLOC(TERM_ARG_BLOCK_SIZE(dataLength, maxArgs));
+        if(dataPtr == NULL) return TERM_CMD_EXIT_ERROR;
+
+        args = (char **) &dataPtr[TERM_ARG_STRINGS_SIZE(dataLength)];
+        argCount = TERM_tokenizeArgs(data, dataLength, dataPtr, args, maxArgs, &errorPosition);
+        if(argCount > TERM_MAX_ARGS) TERM_FREE(dataPtr);
+    }
+#endif
+    
+    if(argCount > TERM_MAX_ARGS){
+        TERM_printArgsError(handle, argCount, errorPosition);
+        return TERM_CMD_EXIT_ERROR;
+    }
+    
+    //the program prints from its own task, so make sure everything we echoed so far goes out first
+    TERM_flushOutput(handle);
+    
+#ifdef TERM_WORKER_STACK_CLASSES
+    if(program != NULL){
         program->argCount = argCount;
-        program->commandString = dataPtr;
         program->args = args;
-        
-        //assign command info
         program->cmd = cmd;
         program->handle = handle;
         
-        //program->returnCode = TERM_CMD_PROC_RUNNING;
-        
-        program->inputStream = xStreamBufferCreate(TERM_PROG_BUFFER_SIZE,1);
-        program->cmdStream = xQueueCreate(5, sizeof(Term_progCMD_t));
-        
-        if(xTaskCreate(TERM_cmdTask, cmd->command, cmd->stackSize, (void*) program, tskIDLE_PRIORITY + 1, &program->task) == pdPASS){
-            //also send the programm into the foreground, to make sure no other one will be started until it is done
-            TERM_sendProgCMD(program, PROG_ENTERFOREGROUND, 0, 0);
-            return TERM_CMD_EXIT_PROC_STARTED;
-        }else{
-            return TERM_CMD_EXIT_ERROR;
-        }
-#else
-        uint8_t retCode = TERM_CMD_EXIT_ERROR;
-        if(cmd->function != 0){
-            retCode = (*cmd->function)(handle, argCount, args);
-        }
-
-        if(argCount != 0) TERM_FREE(args);
-        return retCode;
-#endif      
+#if TERM_MAX_JOBS > 0
+        if(background) TERM_addJob(handle, program);
+#endif
+        //same as below, the program is in the foreground before the worker even gets to run
+        if(!background) TERM_programEnterForeground(program);
+        xTaskNotifyGive(program->task);
+        return TERM_reportStartedProgram(handle, program, background);
     }
+#endif
+    
+#if TERM_STATIC_ALLOCATION == 0
+    program = TERM_MALLOC(sizeof(TermProgram));
+    memset(program, 0, sizeof(TermProgram));
+    
+    //assign data pointers. The arguments are freed together with the command string
+    program->argCount = argCount;
+    program->commandString = dataPtr;
+    program->args = args;
+    
+    //assign command info
+    program->cmd = cmd;
+    program->handle = handle;
+    program->stackSize = stackSize;
+    
+    //program->returnCode = TERM_CMD_PROC_RUNNING;
     
-    return TERM_CMD_EXIT_NOT_FOUND;
+    program->inputStream = xStreamBufferCreate(TERM_PROG_BUFFER_SIZE,1);
+    program->cmdStream = xQueueCreate(TERM_PROG_QUEUE_LENGTH, sizeof(Term_progCMD_t));
+    
+#if TERM_MAX_JOBS > 0
+    //jobs need to be known before they print anything
+    if(background) TERM_addJob(handle, program);
+#endif
+    
+    if(xTaskCreate(TERM_cmdTask, cmd->command, stackSize, (void*) program, tskIDLE_PRIORITY + 1, &program->task) == pdPASS){
+        //also send the programm into the foreground, to make sure no other one will be started until it is done
+        if(!background) TERM_programEnterForeground(program);
+        return TERM_reportStartedProgram(handle, program, background);
+    }else{
+#if TERM_MAX_JOBS > 0
+        if(background) TERM_findJob(handle, program)->state = JOB_FREE;
+#endif
+        return TERM_CMD_EXIT_ERROR;
+    }
+#endif
 }
+#endif
 
-uint8_t TERM_seperateArgs(char * data, uint16_t dataLength, char ** buff){
-    uint8_t count = 0;
-    uint8_t currPos = 0;
-    unsigned quoteMark = 0;
-    char * currStringStart = 0;
-    char * lastSpace = 0;
-    for(;currPos<dataLength; currPos++){
-        switch(data[currPos]){
-            case ' ':
-                if(!quoteMark){
-                    data[currPos] = 0;
-                    lastSpace = &data[currPos + 1];
-                }
-                break;
-                
-            case '"':
-                if(quoteMark){
-                    quoteMark = 0;
-                    if(currStringStart){
-                        data[currPos] = 0;
-                        buff[count++] = currStringStart;
-                    }
-                }else{
-                    quoteMark = 1;
-                    currStringStart = &data[currPos+1];
-                }
-                        
-                break;
-                
-            default:
-                if(!quoteMark){
-                    if(lastSpace != 0){
-                        buff[count++] = lastSpace;
-                        lastSpace = 0;
-                    }
-                }
-                break;
-        }
+uint8_t TERM_interpretCMD(char * data, uint16_t dataLength, TERMINAL_HANDLE * handle){
+#if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
+    unsigned background = 0;
+#if TERM_MAX_JOBS > 0
+    //a trailing '&' runs the command as a job in the background
+    background = TERM_stripBackgroundMarker(data, &dataLength);
+#endif
+#endif
+    
+    //the command name is everything up to the first space
+    char * firstSpace = strnchr(data, ' ', dataLength);
+    TermCommandDescriptor * cmd = TERM_findCMDFromName(handle->cmdListHead, data, (firstSpace != NULL) ? firstSpace - data : dataLength);
+    
+    if(cmd == 0) return TERM_CMD_EXIT_NOT_FOUND;
+    
+#if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
+    //everything but the commands the terminal runs itself gets a task
+    if(cmd->stackSize != TERM_INLINE_STACKSIZE) return TERM_startProgram(cmd, data, dataLength, handle, background);
+#endif
+    
+    //the command runs right away, so the line can be tokenized where it is
+    uint16_t errorPosition = 0;
+    char * args[TERM_MAX_ARGS];
+    uint16_t argCount = TERM_tokenizeArgs(data, dataLength, data, args, TERM_MAX_ARGS, &errorPosition);
+    
+    if(argCount > TERM_MAX_ARGS){
+        TERM_printArgsError(handle, argCount, errorPosition);
+        return TERM_CMD_EXIT_ERROR;
     }
-    if(quoteMark) TERM_ARGS_ERROR_STRING_LITERAL;
-    return count;
+    
+    uint8_t retCode = TERM_CMD_EXIT_ERROR;
+    if(cmd->function != 0){
+        retCode = (*cmd->function)(handle, argCount, args);
+    }
+    
+    return retCode;
 }
 
-uint16_t TERM_countArgs(const char * data, uint16_t dataLength){
-    uint8_t count = 0;
-    uint8_t currPos = 0;
+//splits a command line into its arguments in a single pass. The first word is the command itself and isn't counted.
+//Every argument is written into strings with a terminator after it and gets a pointer in args. Nothing written is ever longer than what was read, so strings may be data itself.
+//Arguments are separated by spaces, parts in quotation marks can contain them and a backslash takes the character after it as it is (\" or \\ f.E.). Quoted parts and the text right next to them are one argument, like in a shell.
+//Returns the number of arguments or one of the TERM_ARGS_ERROR_ codes with errorPosition set to the character that caused it
+uint16_t TERM_tokenizeArgs(const char * data, uint16_t dataLength, char * strings, char ** args, uint16_t maxArgs, uint16_t * errorPosition){
+    uint16_t count = 0;
+    uint16_t currPos = 0;
+    uint16_t quoteStart = 0;
     unsigned quoteMark = 0;
-    const char * currStringStart = NULL;
-    const char * lastSpace = NULL;
-    for(;currPos<dataLength; currPos++){
-        switch(data[currPos]){
-            case ' ':
-                if(!quoteMark){
-                    lastSpace = &data[currPos + 1];
-                }
-                break;
-                
-            case '"':
-                if(quoteMark){
-                    quoteMark = 0;
-                    if(currStringStart){
-                        count ++;
-                    }
-                }else{
-                    quoteMark = 1;
-                    currStringStart = &data[currPos+1];
-                }
-                        
-                break;
-                
-            default:
-                if(!quoteMark){
-                    if(lastSpace){
-                        count ++;
-                        lastSpace = NULL;
-                    }
+    unsigned inWord = 0;
+    unsigned commandDone = 0;
+    char * writePtr = strings;
+    
+    for(;currPos < dataLength; currPos++){
+        char c = data[currPos];
+        
+        if(c == ' ' && !quoteMark){
+            if(inWord){
+                *writePtr++ = 0;
+                inWord = 0;
+                commandDone = 1;
+            }
+            continue;
+        }
+        
+        //does a new argument start here?
+        if(!inWord){
+            inWord = 1;
+            if(commandDone){
+                if(count == maxArgs){
+                    *errorPosition = currPos;
+                    return TERM_ARGS_ERROR_TOO_MANY;
                 }
-                break;
+                args[count++] = writePtr;
+            }
+        }
+        
+        if(c == '\\'){
+            if(++currPos == dataLength){
+                *errorPosition = currPos - 1;
+                return TERM_ARGS_ERROR_ESCAPE;
+            }
+            *writePtr++ = data[currPos];
+        }else if(c == '"'){
+            quoteMark = !quoteMark;
+            quoteStart = currPos;
+        }else{
+            *writePtr++ = c;
         }
     }
-    if(quoteMark) TERM_ARGS_ERROR_STRING_LITERAL;
+    
+    if(quoteMark){
+        *errorPosition = quoteStart;
+        return TERM_ARGS_ERROR_STRING_LITERAL;
+    }
+    
+    *writePtr = 0;
     return count;
 }
 
@@ -1247,10 +2417,9 @@ void TERM_freeCommandList(TermCommandDescriptor ** cl, uint16_t length){
 
 TermCommandDescriptor * TERM_addCommand(TermCommandFunction function, const char * command, const char * description, uint32_t stackSize, TermCommandDescriptor * head){
     //if(head == NULL) head = TERM_defaultList;
-        
-    if(head->commandLength == 0xff) return 0;
     
     TermCommandDescriptor * newCMD = TERM_MALLOC(sizeof(TermCommandDescriptor));
+    if(newCMD == NULL) return 0;
     
     newCMD->command = command;
     newCMD->commandDescription = description;
@@ -1269,32 +2438,192 @@ TermCommandDescriptor * TERM_addCommand(TermCommandFunction function, const char
     return newCMD;
 }
 
+//(re)builds the hash index of a list with size buckets. Returns 0 and keeps the old one if there isn't enough memory for the new one
+static unsigned TERM_rehashCommandList(TermCommandDescriptor * head, TermCommandIndex * index, uint32_t size){
+    TermCommandDescriptor ** table = TERM_MALLOC(size * sizeof(TermCommandDescriptor *));
+    if(table == NULL) return 0;
+    memset(table, 0, size * sizeof(TermCommandDescriptor *));
+    
+    uint32_t currPos = 0;
+    TermCommandDescriptor * currCmd = head->nextCmd;
+    TermCommandDescriptor ** lastInBucket;
+    for(;currPos < head->commandLength; currPos++){
+        //append so the order in the buckets stays the same as in the list
+        lastInBucket = &table[TERM_hashCommand(currCmd->command, currCmd->commandLength) & (size - 1)];
+        while(*lastInBucket != NULL) lastInBucket = &(*lastInBucket)->nextHash;
+        *lastInBucket = currCmd;
+        currCmd->nextHash = NULL;
+        currCmd = currCmd->nextCmd;
+    }
+    
+    if(index->hashTable != NULL) TERM_FREE(index->hashTable);
+    index->hashTable = table;
+    index->hashTableSize = size;
+    return 1;
+}
+
+//returns the index of a list head, lists that were set up without one get it with their first command. NULL if there isn't enough memory for it
+static TermCommandIndex * TERM_getCommandIndex(TermCommandDescriptor * head){
+    if(head->index != NULL) return head->index;
+    
+    head->index = TERM_MALLOC(sizeof(TermCommandIndex));
+    if(head->index != NULL) memset(head->index, 0, sizeof(TermCommandIndex));
+    return head->index;
+}
+
+//adds a command to the list in O(1). New commands go to the front of the list, TERM_sortCommandList puts them in their place once someone needs the list sorted
 void TERM_LIST_add(TermCommandDescriptor * item, TermCommandDescriptor * head){
+    TermCommandIndex * index = TERM_getCommandIndex(head);
+    
+    item->nextCmd = head->nextCmd;
+    head->nextCmd = item;
+    head->commandLength ++;
+    item->nextHash = NULL;
+    
+    //without an index the list just gets sorted and searched every time
+    if(index == NULL) return;
+    
+    if(head->commandLength > 1) index->unsorted = 1;
+    
+    //if the completion index can't take the command it gets rebuilt on the next tab
+    if(index->trie != NULL && !TERM_trieInsert(index->trie, item->command, item->commandLength)) TERM_freeCommandTrie(head);
+    
+    //keep at most one command per bucket on average
+    if(index->hashTable == NULL || head->commandLength > index->hashTableSize){
+        if(TERM_rehashCommandList(head, index, (index->hashTable == NULL) ? TERM_CMD_HASH_INITIAL_SIZE : index->hashTableSize * 2)) return;
+        
+        //no memory for a bigger index. Lookups fall back to the list if there is none at all, otherwise the buckets just get a bit longer
+        if(index->hashTable == NULL) return;
+    }
+    
+    //new commands go in front, so a duplicate name finds the newest one (same as the sorted list did)
+    TermCommandDescriptor ** bucket = &index->hashTable[TERM_hashCommand(item->command, item->commandLength) & (index->hashTableSize - 1)];
+    item->nextHash = *bucket;
+    *bucket = item;
+}
+
+//merges two sorted lists, on equal names the command from a comes first
+static TermCommandDescriptor * TERM_mergeCommandLists(TermCommandDescriptor * a, TermCommandDescriptor * b){
+    TermCommandDescriptor * first = NULL;
+    TermCommandDescriptor ** last = &first;
+    
+    while(a != NULL && b != NULL){
+        //TERM_isSorted(b, a) is also true if the two are identical
+        if(TERM_isSorted(b, a)){
+            *last = a;
+            a = a->nextCmd;
+        }else{
+            *last = b;
+            b = b->nextCmd;
+        }
+        last = &(*last)->nextCmd;
+    }
+    *last = (a != NULL) ? a : b;
+    
+    return first;
+}
+
+//sorts the list alphabetically (bottom up merge sort, no recursion and no allocation). Does nothing if no command was added since the last call
+void TERM_sortCommandList(TermCommandDescriptor * head){
+    //a list without an index doesn't know if it is sorted already
+    if(head->index != NULL && !head->index->unsorted) return;
+    
+    //bins[i] holds a sorted run of 2^i commands
+    TermCommandDescriptor * bins[32];
+    uint32_t binCount = 0;
+    uint32_t currBin;
+    memset(bins, 0, sizeof(bins));
+    
+    TermCommandDescriptor * currCmd = head->nextCmd;
     uint32_t currPos = 0;
-    TermCommandDescriptor ** lastComp = &head->nextCmd;
-    TermCommandDescriptor * currComp = head->nextCmd;
-    
-    while(currPos < head->commandLength){
-        if(TERM_isSorted(currComp, item)){
-            *lastComp = item;
-            item->nextCmd = currComp;
-            head->commandLength ++;
-            
-            return;
+    for(;currPos < head->commandLength; currPos++){
+        TermCommandDescriptor * run = currCmd;
+        currCmd = currCmd->nextCmd;
+        run->nextCmd = NULL;
+        
+        //runs in lower bins come from further up in the list, pass them as a to keep the order of identical names
+        for(currBin = 0; currBin < binCount && bins[currBin] != NULL; currBin++){
+            run = TERM_mergeCommandLists(bins[currBin], run);
+            bins[currBin] = NULL;
         }
-        if(currComp->nextCmd == 0){
-            item->nextCmd = currComp->nextCmd;
-            currComp->nextCmd = item;
-            head->commandLength ++;
-            return;
+        if(currBin == binCount) binCount++;
+        bins[currBin] = run;
+    }
+    
+    TermCommandDescriptor * sorted = NULL;
+    for(currBin = 0; currBin < binCount; currBin++){
+        if(bins[currBin] != NULL) sorted = TERM_mergeCommandLists(bins[currBin], sorted);
+    }
+    
+    head->nextCmd = sorted;
+    if(head->index != NULL) head->index->unsorted = 0;
+}
+
+static void TERM_freeCommandTrie(TermCommandDescriptor * head){
+    TERM_trieFree(head->index->trie);
+    TERM_FREE(head->index->trie);
+    head->index->trie = NULL;
+}
+
+//prefix index over all commands of the list (static ones included) for completion. Returns NULL if there isn't enough memory for it
+const TermTrie * TERM_getCommandTrie(TermCommandDescriptor * head){
+    TermCommandIndex * index = TERM_getCommandIndex(head);
+    if(index == NULL) return NULL;
+    if(index->trie != NULL) return index->trie;
+    
+    index->trie = TERM_MALLOC(sizeof(TermTrie));
+    if(index->trie == NULL) return NULL;
+    TERM_trieInit(index->trie);
+    
+    TermCommandIterator iterator;
+    TERM_initCommandIterator(&iterator, head);
+    const TermCommandDescriptor * currCMD;
+    while((currCMD = TERM_nextCommand(&iterator)) != NULL){
+        if(!TERM_trieInsert(index->trie, currCMD->command, currCMD->commandLength)){
+            TERM_freeCommandTrie(head);
+            return NULL;
         }
-        lastComp = &currComp->nextCmd;
-        currComp = currComp->nextCmd;
     }
+    return index->trie;
+}
+
+//number of commands in a list including its static table. A command that is in both is counted twice
+uint32_t TERM_getCommandCount(TermCommandDescriptor * head){
+    uint32_t count = head->commandLength;
+    if(head->index != NULL && head->index->staticCommands != NULL) count += head->index->staticCommandsEnd - head->index->staticCommands;
+    return count;
+}
+
+void TERM_initCommandIterator(TermCommandIterator * iterator, TermCommandDescriptor * head){
+    TERM_sortCommandList(head);
+    iterator->nextCmd = head->nextCmd;
+    iterator->remaining = head->commandLength;
+    iterator->nextStatic = (head->index != NULL) ? head->index->staticCommands : NULL;
+    iterator->staticEnd = (head->index != NULL) ? head->index->staticCommandsEnd : NULL;
+}
+
+//returns the next command in alphabetical order or NULL once all were returned. Both the list and the static table are sorted already, so this just merges the two
+const TermCommandDescriptor * TERM_nextCommand(TermCommandIterator * iterator){
+    const TermCommandDescriptor * ret;
+    unsigned staticLeft = iterator->nextStatic != NULL && iterator->nextStatic < iterator->staticEnd;
     
-    item->nextCmd = 0;
-    *lastComp = item;
-    head->commandLength ++;
+    if(iterator->remaining == 0){
+        if(!staticLeft) return NULL;
+        return iterator->nextStatic++;
+    }
+    
+    ret = iterator->nextCmd;
+    if(staticLeft){
+        int32_t result = TERM_compareCommandName(ret->command, ret->commandLength, iterator->nextStatic);
+        if(result > 0) return iterator->nextStatic++;
+        
+        //a command in the list hides the static one with the same name
+        if(result == 0) iterator->nextStatic++;
+    }
+    
+    iterator->nextCmd = ret->nextCmd;
+    iterator->remaining--;
+    return ret;
 }
 /*
 void ACL_remove(AC_LIST_HEAD * head, char * string){
@@ -1323,31 +2652,11 @@ void ACL_remove(AC_LIST_HEAD * head, char * string){
 }
 */
 
+//returns 1 if b belongs in front of a (or they are identical). Commands are sorted the way strcmp does it, which is also the order the linker puts the static ones in
 unsigned TERM_isSorted(TermCommandDescriptor * a, TermCommandDescriptor * b){
-    uint8_t currPos = 0;
-    //compare the lowercase ASCII values of each character in the command (They are alphabetically sorted)
-    for(;currPos < a->commandLength && currPos < b->commandLength; currPos++){
-        char letterA = toLowerCase(a->command[currPos]);
-        char letterB = toLowerCase(b->command[currPos]);
-        //if the letters are different we return 1 if a is smaller than b (they are correctly sorted) or zero if its the other way around
-        if(letterA > letterB){
-            return 1;
-        }else if(letterB > letterA){
-            return 0;
-        }
-    }
-    
-    //the two commands have identical letters for their entire length we check which one is longer (the shortest should come first)
-    if(a->commandLength > b->commandLength){
-        return 1;
-    }else if(b->commandLength > a->commandLength){
-        return 0;
-    }else{
-        //it might happen that a command is added twice (or two identical ones are added), in which case we just say they are sorted correctly and print an error in the console
-        //TODO implement an alarm here
-        //UART_print("WARNING: Found identical commands: \"%S\" and \"%S\"\r\n", a->command, b->command);        
-        return 1;
-    }
+    //it might happen that a command is added twice (or two identical ones are added), in which case we just say they are sorted correctly
+    //TODO implement an alarm here
+    return TERM_compareCommandName(a->command, a->commandLength, b) >= 0;
 }
 
 char toLowerCase(char c){
@@ -1368,223 +2677,20 @@ char toLowerCase(char c){
     }
 }
 
+//moves the cursor to column x and row y (both starting at 1). Pass _VT100_POS_IGNORE for one of them to leave it where it is
 void TERM_setCursorPos(TERMINAL_HANDLE * handle, uint16_t x, uint16_t y){
-    
+    char buffer[TERM_VT100_MAX_SEQUENCE_LENGTH];
+    uint32_t length = TERM_formatVT100CursorPos(buffer, x, y);
+    if(length) ttwriteEcho(buffer, length);
 }
 
-void TERM_sendVT100Code(TERMINAL_HANDLE * handle, uint16_t cmd, uint8_t var){
-    switch(cmd){
-        case _VT100_RESET:
-            ttprintfEcho("%cc", 0x1b);
-            break;
-        case _VT100_CURSOR_BACK:
-            ttprintfEcho("\x1b[D");
-            break;
-        case _VT100_CURSOR_FORWARD:
-            ttprintfEcho("\x1b[C");
-            break;
-        case _VT100_CURSOR_POS1:
-            ttprintfEcho("\x1b[H");
-            break;
-        case _VT100_CURSOR_END:
-            ttprintfEcho("\x1b[F");
-            break;
-        case _VT100_FOREGROUND_COLOR:
-            ttprintfEcho("\x1b[%dm", var+30);
-            break;
-        case _VT100_BACKGROUND_COLOR:
-            ttprintfEcho("\x1b[%dm", var+40);
-            break;
-        case _VT100_RESET_ATTRIB:
-            ttprintfEcho("\x1b[0m");
-            break;
-        case _VT100_BRIGHT:
-            ttprintfEcho("\x1b[1m");
-            break;
-        case _VT100_DIM:
-            ttprintfEcho("\x1b[2m");
-            break;
-        case _VT100_UNDERSCORE:
-            ttprintfEcho("\x1b[4m");
-            break;
-        case _VT100_BLINK:
-            ttprintfEcho("\x1b[5m");
-            break;
-        case _VT100_REVERSE:
-            ttprintfEcho("\x1b[7m");
-            break;
-        case _VT100_HIDDEN:
-            ttprintfEcho("\x1b[8m");
-            break;
-        case _VT100_ERASE_SCREEN:
-            ttprintfEcho("\x1b[2J");
-            break;
-        case _VT100_ERASE_LINE:
-            ttprintfEcho("\x1b[2K");
-            break;
-        case _VT100_FONT_G0:
-            ttprintfEcho("\x1b(");
-            break;
-        case _VT100_FONT_G1:
-            ttprintfEcho("\x1b)");
-            break;
-        case _VT100_WRAP_ON:
-            ttprintfEcho("\x1b[7h");
-            break;
-        case _VT100_WRAP_OFF:
-            ttprintfEcho("\x1b[7l");
-            break;
-        case _VT100_ERASE_LINE_END:
-            ttprintfEcho("\x1b[K");
-            break;
-        case _VT100_CURSOR_BACK_BY:
-            ttprintfEcho("\x1b[%dD", var);
-            break;
-        case _VT100_CURSOR_FORWARD_BY:
-            ttprintfEcho("\x1b[%dC", var);
-            break;
-        case _VT100_CURSOR_SAVE_POSITION:
-            ttprintfEcho("\x1b" "7");
-            break;
-        case _VT100_CURSOR_RESTORE_POSITION:
-            ttprintfEcho("\x1b" "8");
-            break;
-        case _VT100_CURSOR_ENABLE:
-            ttprintfEcho("\x1b[?25h");
-            break;
-        case _VT100_CURSOR_DISABLE:
-            ttprintfEcho("\x1b[?25l");
-            break;
-        case _VT100_CLS:
-            ttprintfEcho("\x1b[2J\033[1;1H");
-            break;
-        case _VT100_CURSOR_DOWN_BY:
-            ttprintfEcho("\x1b[%dB", var);
-            break;
-        case _VT100_CURSOR_UP_BY:
-            ttprintfEcho("\x1b[%dA", var);
-            break;
-            
-    }
+void TERM_sendVT100Code(TERMINAL_HANDLE * handle, uint16_t cmd, uint16_t var){
+    char buffer[TERM_VT100_MAX_SEQUENCE_LENGTH];
+    uint32_t length;
+    const char * sequence = TERM_getVT100Sequence(cmd, var, buffer, &length);
+    if(length) ttwriteEcho(sequence, length);
 }
 
-//returns a static pointer to the requested VT100 code, so it can be used in printf without needing any free() call afterwards
-const char * TERM_getVT100Code(uint16_t cmd, uint8_t var){
-    //INFO this is deprecated since all of the VT100 functions are handled by the terminal now
-    switch(cmd){
-        case _VT100_RESET:
-            return "\x1b" "C";
-            
-        case _VT100_CURSOR_BACK:
-            return "\x1b[D";
-            
-        case _VT100_CURSOR_FORWARD:
-            return "\x1b[C";
-            
-        case _VT100_CURSOR_POS1:
-            return "\x1b[H";
-            
-        case _VT100_CURSOR_END:
-            return "\x1b[F";
-        case _VT100_FOREGROUND_COLOR:
-            switch(var){
-                case 0:
-                    return "\x1b[30m";
-                case 1:
-                    return "\x1b[31m";
-                case 2:
-                    return "\x1b[32m";
-                case 3:
-                    return "\x1b[33m";
-                case 4:
-                    return "\x1b[34m";
-                case 5:
-                    return "\x1b[35m";
-                case 6:
-                    return "\x1b[36m";
-                case 7:
-                    return "\x1b[37m";
-                default:
-                    return "\x1b[30m";
-            }
-            
-        case _VT100_BACKGROUND_COLOR:
-            switch(var){
-                case 0:
-                    return "\x1b[40m";
-                case 1:
-                    return "\x1b[41m";
-                case 2:
-                    return "\x1b[42m";
-                case 3:
-                    return "\x1b[43m";
-                case 4:
-                    return "\x1b[44m";
-                case 5:
-                    return "\x1b[45m";
-                case 6:
-                    return "\x1b[46m";
-                case 7:
-                    return "\x1b[47m";
-                default:
-                    return "\x1b[40m";
-            }
-            
-        case _VT100_RESET_ATTRIB:
-            return "\x1b[0m";
-            
-        case _VT100_BRIGHT:
-            return "\x1b[1m";
-            
-        case _VT100_DIM:
-            return "\x1b[2m";
-            
-        case _VT100_UNDERSCORE:
-            return "\x1b[4m";
-            
-        case _VT100_BLINK:
-            return "\x1b[5m";
-            
-        case _VT100_REVERSE:
-            return "\x1b[7m";
-            
-        case _VT100_HIDDEN:
-            return "\x1b[8m";
-            
-        case _VT100_ERASE_SCREEN:
-            return "\x1b[2J";
-            
-        case _VT100_ERASE_LINE:
-            return "\x1b[2K";
-            
-        case _VT100_FONT_G0:
-            return "\x1b(";
-            
-        case _VT100_FONT_G1:
-            return "\x1b)";
-            
-        case _VT100_WRAP_ON:
-            return "\x1b[7h";
-            
-        case _VT100_WRAP_OFF:
-            return "\x1b[71";
-            
-        case _VT100_ERASE_LINE_END:
-            return "\x1b[K";
-            
-        case _VT100_CURSOR_ENABLE:
-            return "\x1b[?25h";
-            
-        case _VT100_CURSOR_DISABLE:
-            return "\x1b[?25l";
-            
-        case _VT100_CLS:
-            return "\x1b[2J\033[1;1H";
-            
-            
-    }
-    return "";
-}
 /*
 void TERM_attachProgramm(TERMINAL_HANDLE * handle, TermProgram * prog){
     //TODO re-implement this for terminals without taskPerCommand
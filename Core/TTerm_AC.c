@@ -32,49 +32,324 @@
 #include "TTerm.h"
 #include "TTerm_cmd.h"
 #include "TTerm_AC.h"
+#include "TTerm_line.h"
 
 void TERM_addCommandAC(TermCommandDescriptor * cmd, TermAutoCompHandler ACH, void * ACParams){
     cmd->ACHandler = ACH;
     cmd->ACParams = ACParams;
 }
 
+//characters after which a completer might look for something else entirely (the next argument, another directory...)
+static unsigned TERM_isWordBreak(char c){
+    return c == ' ' || c == '"' || c == '/';
+}
+
+//the part of the line that is being completed, without the quotation mark
+static const char * TERM_getCompletionPrefix(TERMINAL_HANDLE * handle, uint32_t * length){
+    uint32_t start = handle->autocompleteStart;
+    if(start < handle->currBufferLength && handle->inputBuffer[start] == '"') start++;
+    *length = handle->currBufferLength - start;
+    return &handle->inputBuffer[start];
+}
+
+//if the line only got longer in the same word since the candidates were found, they just need to be filtered instead of searched for again.
+//Candidates in a trie continue from the node they're in, ones in a sorted slice are searched for in that slice only
+static unsigned TERM_narrowCompletion(TERMINAL_HANDLE * handle){
+    uint32_t oldLength = handle->autocompleteLineLength;
+    if(oldLength == 0 || handle->currBufferLength < oldLength) return 0;
+    if(handle->autocompleteVersion != NULL && *handle->autocompleteVersion != handle->autocompleteVersionValue) return 0;
+    
+    uint32_t currPos = oldLength;
+    for(;currPos < handle->currBufferLength; currPos++){
+        if(TERM_isWordBreak(handle->inputBuffer[currPos])) return 0;
+    }
+    if(memcmp(handle->inputBuffer, handle->autocompleteLine, oldLength) != 0) return 0;
+    
+    uint32_t length;
+    const char * prefix = TERM_getCompletionPrefix(handle, &length);
+    
+    if(handle->autocompleteNode != NULL){
+        handle->autocompleteNode = TERM_trieNarrow(handle->autocompleteNode, prefix, length, &handle->autocompleteNodeDepth);
+        handle->autocompleteBufferLength = (handle->autocompleteNode != NULL) ? handle->autocompleteNode->keyCount : 0;
+    }else{
+        uint32_t first;
+        handle->autocompleteBufferLength = ACL_findSliceRange((char * const *) handle->autocompleteSlice, handle->autocompleteBufferLength, prefix, length, &first);
+        handle->autocompleteSlice += first;
+    }
+    
+#if TERM_FUZZY_COMPLETION == 1
+    //nothing starts with it anymore, the fuzzy matches need a search through the whole list
+    if(handle->autocompleteBufferLength == 0) return 0;
+#endif
+    
+    //nothing left to narrow down next time
+    if(handle->autocompleteBufferLength == 0){
+        handle->autocompleteLineLength = 0;
+        return 1;
+    }
+    
+    //the start is the same already, only what was typed since needs to be remembered
+    memcpy(&handle->autocompleteLine[oldLength], &handle->inputBuffer[oldLength], handle->currBufferLength - oldLength);
+    handle->autocompleteLineLength = handle->currBufferLength;
+    return 1;
+}
+
+#if TERM_FUZZY_COMPLETION == 1
+//best matches found so far while going through a list once
+typedef struct{
+    const char * pattern;
+    uint32_t length;
+    uint32_t count;
+    const char * candidates[TERM_FUZZY_MAX_CANDIDATES];
+    uint32_t scores[TERM_FUZZY_MAX_CANDIDATES];
+} TermFuzzyMatches;
+
+static unsigned TERM_isWordStart(const char * candidate, uint32_t pos){
+    if(pos == 0) return 1;
+    char last = candidate[pos - 1];
+    if(last == '-' || last == '_' || last == '/' || last == '.' || last == ' ') return 1;
+    //camelCase
+    return candidate[pos] >= 'A' && candidate[pos] <= 'Z' && last >= 'a' && last <= 'z';
+}
+
+//how well pattern matches candidate as a subsequence, ignoring case. 0 if it doesn't.
+//The characters are matched as early as possible, each one counts and more so if it directly follows the last one or starts a word. Shorter candidates win a tie
+static uint32_t TERM_fuzzyScore(const char * pattern, uint32_t length, const char * candidate){
+    uint32_t score = 0;
+    uint32_t patternPos = 0;
+    uint32_t currPos = 0;
+    unsigned lastMatched = 0;
+    
+    for(;candidate[currPos] != 0; currPos++){
+        if(patternPos == length || toLowerCase(candidate[currPos]) != toLowerCase(pattern[patternPos])){
+            lastMatched = 0;
+            continue;
+        }
+        score += 1;
+        if(lastMatched) score += 4;
+        if(TERM_isWordStart(candidate, currPos)) score += 3;
+        lastMatched = 1;
+        patternPos++;
+    }
+    if(patternPos != length) return 0;
+    
+    return (score << 8) | (0xff - ((currPos > 0xff) ? 0xff : currPos));
+}
+
+//keeps candidate if it is one of the best TERM_FUZZY_MAX_CANDIDATES so far. The matches stay sorted by score, so this is at most one short insertion
+static void TERM_fuzzyAdd(TermFuzzyMatches * matches, const char * candidate){
+    uint32_t score = TERM_fuzzyScore(matches->pattern, matches->length, candidate);
+    if(score == 0) return;
+    if(matches->count == TERM_FUZZY_MAX_CANDIDATES && score <= matches->scores[TERM_FUZZY_MAX_CANDIDATES - 1]) return;
+    
+    if(matches->count < TERM_FUZZY_MAX_CANDIDATES) matches->count++;
+    uint32_t currPos = matches->count - 1;
+    while(currPos > 0 && matches->scores[currPos - 1] < score){
+        matches->scores[currPos] = matches->scores[currPos - 1];
+        matches->candidates[currPos] = matches->candidates[currPos - 1];
+        currPos--;
+    }
+    matches->scores[currPos] = score;
+    matches->candidates[currPos] = candidate;
+}
+
+static uint32_t TERM_fuzzyFinish(TERMINAL_HANDLE * handle, TermFuzzyMatches * matches){
+    memcpy(handle->autocompleteRanked, matches->candidates, matches->count * sizeof(char *));
+    handle->autocompleteSlice = handle->autocompleteRanked;
+    handle->autocompleteBufferLength = matches->count;
+    return matches->count;
+}
+
+//offers the best subsequence matches of currInput among count strings, best one first
+uint32_t TERM_completeFuzzy(TERMINAL_HANDLE * handle, char * const * strings, uint32_t count, const char * currInput, uint32_t length){
+    TermFuzzyMatches matches = {.pattern = currInput, .length = length, .count = 0};
+    uint32_t currPos = 0;
+    for(;currPos < count; currPos++) TERM_fuzzyAdd(&matches, strings[currPos]);
+    return TERM_fuzzyFinish(handle, &matches);
+}
+
+static uint32_t TERM_fuzzyCompleteCommands(TERMINAL_HANDLE * handle){
+    TermFuzzyMatches matches = {.pattern = handle->inputBuffer, .length = handle->currBufferLength, .count = 0};
+    TermCommandIterator iterator;
+    TERM_initCommandIterator(&iterator, handle->cmdListHead);
+    const TermCommandDescriptor * currCMD;
+    while((currCMD = TERM_nextCommand(&iterator)) != NULL) TERM_fuzzyAdd(&matches, currCMD->command);
+    return TERM_fuzzyFinish(handle, &matches);
+}
+#endif
+
 uint8_t TERM_doAutoComplete(TERMINAL_HANDLE * handle){
+    //the completers all work on the plain string
+    TERM_lineGetString(handle);
+    handle->currAutocompleteCount = 0;
+    
+    if(TERM_narrowCompletion(handle)){
+        handle->autocompleteActive = 1;
+        return handle->autocompleteBufferLength;
+    }
+    
+    TERM_clearCompletion(handle);
+    handle->autocompleteActive = 1;
+    
     if(strnchr(handle->inputBuffer, ' ', handle->currBufferLength) != NULL){
         TermCommandDescriptor * cmd = TERM_findCMD(handle);
-        if(cmd != NULL){
-            if(cmd->ACHandler == 0){
-                handle->currAutocompleteCount = 0;
-                handle->autocompleteStart = 0;
-                handle->autocompleteBufferLength = 0;
-                return 0;
-            }else{
-                return (*cmd->ACHandler)(handle, cmd->ACParams);
-            }
-        } 
-        handle->currAutocompleteCount = 0;
-        handle->autocompleteStart = 0;
-        handle->autocompleteBufferLength = 0;
-        return 0;
+        if(cmd == NULL || cmd->ACHandler == 0) return 0;
+        (*cmd->ACHandler)(handle, cmd->ACParams);
     }else{
-        handle->autocompleteBuffer = TERM_MALLOC(handle->cmdListHead->commandLength * sizeof(char *));
-        handle->currAutocompleteCount = 0;
-        handle->autocompleteBufferLength = TERM_findMatchingCMDs(handle->inputBuffer, handle->currBufferLength, handle->autocompleteBuffer, handle->cmdListHead);
-        handle->autocompleteStart = 0;
-        return handle->autocompleteBufferLength;
+        //all commands starting with the input are in the trie below the node the input ends in, so nothing needs to be collected
+        const TermTrie * trie = TERM_getCommandTrie(handle->cmdListHead);
+        if(trie == NULL) return 0;
+        
+        handle->autocompleteNode = TERM_trieFindPrefix(trie, handle->inputBuffer, handle->currBufferLength, &handle->autocompleteNodeDepth);
+        if(handle->autocompleteNode != NULL) handle->autocompleteBufferLength = handle->autocompleteNode->keyCount;
+#if TERM_FUZZY_COMPLETION == 1
+        if(handle->autocompleteNode == NULL) TERM_fuzzyCompleteCommands(handle);
+#endif
+        //commands are never removed, so the count changes with every change of the trie
+        handle->autocompleteVersion = &handle->cmdListHead->commandLength;
+        handle->autocompleteVersionValue = handle->cmdListHead->commandLength;
     }
+    
+    //only candidates that point into a sorted list can be narrowed, the ones in a buffer of a custom completer are searched for again
+    unsigned narrowable = handle->autocompleteNode != NULL || handle->autocompleteSlice != NULL;
+#if TERM_FUZZY_COMPLETION == 1
+    //fuzzy matches aren't sorted and the next character might make a prefix match possible again
+    if(handle->autocompleteSlice == handle->autocompleteRanked) narrowable = 0;
+#endif
+    if(handle->autocompleteBufferLength != 0 && narrowable){
+        handle->autocompleteLineLength = handle->currBufferLength;
+        memcpy(handle->autocompleteLine, handle->inputBuffer, handle->currBufferLength);
+    }
+    return handle->autocompleteBufferLength;
 }
 
-uint8_t TERM_findMatchingCMDs(char * currInput, uint8_t length, char ** buff, TermCommandDescriptor * cmdListHead){
+//returns candidate number index of the current completion, no matter where the completer put them
+const char * TERM_getCompletion(TERMINAL_HANDLE * handle, uint32_t index){
+    if(index >= handle->autocompleteBufferLength) return NULL;
+    if(handle->autocompleteNode != NULL) return TERM_trieGetKey(handle->autocompleteNode, index);
+    if(handle->autocompleteSlice != NULL) return handle->autocompleteSlice[index];
+    return handle->autocompleteBuffer[index];
+}
+
+//length of the part all candidates start with. example is set to one of them
+uint32_t TERM_getCompletionCommonPrefix(TERMINAL_HANDLE * handle, const char ** example){
+    if(handle->autocompleteBufferLength == 0) return 0;
+    if(handle->autocompleteNode != NULL) return TERM_trieCommonPrefix(handle->autocompleteNode, handle->autocompleteNodeDepth, example);
+    
+    const char * first = TERM_getCompletion(handle, 0);
+    uint32_t length = strlen(first);
+    uint32_t currIndex = 1;
+    for(;currIndex < handle->autocompleteBufferLength && length > 0; currIndex++){
+        const char * curr = TERM_getCompletion(handle, currIndex);
+        uint32_t currLength = 0;
+        while(currLength < length && curr[currLength] == first[currLength]) currLength++;
+        length = currLength;
+    }
+    *example = first;
+    return length;
+}
+
+//puts whatever all candidates share past the typed part of the word into the line. Returns 1 if it did, the candidates are dropped then as the input got longer
+unsigned TERM_completeCommonPrefix(TERMINAL_HANDLE * handle){
+    const char * example;
+    uint32_t commonLength = TERM_getCompletionCommonPrefix(handle, &example);
+    
+    uint32_t typedLength;
+    TERM_lineGetString(handle);
+    const char * typed = TERM_getCompletionPrefix(handle, &typedLength);
+    
+    //candidates with spaces need quotation marks, they are only put in as a whole (see TERM_checkForCopy). Same for ones that don't start with what was typed (fuzzy matches)
+    if(commonLength <= typedLength || memchr(example, ' ', commonLength) != NULL) return 0;
+    if(memcmp(example, typed, typedLength) != 0) return 0;
+    
+    //get the cursor to the end of the line on screen, then the new part just needs to be printed there
+    TERM_lineShow(handle, handle->inputBuffer, handle->currBufferLength, "", 0);
+    ttwriteEcho(&example[typedLength], commonLength - typedLength);
+    
+    TERM_lineSetCursor(handle, handle->currBufferLength);
+    TERM_lineInsert(handle, &example[typedLength], commonLength - typedLength);
+    TERM_endCompletion(handle);
+    return 1;
+}
+
+//prints all candidates below the line in as many columns as fit into the terminal, sorted top to bottom like ls does. Prompt and line are printed again below them
+void TERM_listCompletions(TERMINAL_HANDLE * handle){
+    static const char spaces[] = "                ";
+    uint32_t count = handle->autocompleteBufferLength;
+    if(count == 0) return;
+
+    //the longest candidate decides how wide the columns are
+    uint32_t width = 0;
+    uint32_t currIndex = 0;
+    for(;currIndex < count; currIndex++){
+        uint32_t length = strlen(TERM_getCompletion(handle, currIndex));
+        if(length > width) width = length;
+    }
+    width += 2;
+
+    uint32_t columns = (width < handle->termColumns) ? handle->termColumns / width : 1;
+    uint32_t rows = (count + columns - 1) / columns;
+
+    //get the cursor to the end of the line, the list starts below it
+    TERM_lineShow(handle, TERM_lineGetString(handle), handle->currBufferLength, "", 0);
+
+    uint32_t currRow = 0;
+    for(;currRow < rows; currRow++){
+        ttwriteLiteralEcho("\r\n");
+
+        for(currIndex = currRow; currIndex < count; currIndex += rows){
+            const char * completion = TERM_getCompletion(handle, currIndex);
+            uint32_t length = strlen(completion);
+            ttwriteEcho(completion, length);
+
+            //last one in this row doesn't need any padding
+            if(currIndex + rows >= count) break;
+
+            uint32_t padding = width - length;
+            while(padding > 0){
+                uint32_t chunk = (padding < sizeof(spaces) - 1) ? padding : sizeof(spaces) - 1;
+                ttwriteEcho(spaces, chunk);
+                padding -= chunk;
+            }
+        }
+    }
+
+    TERM_printPrompt(handle, "\r\n");
+    TERM_linePrint(handle);
+}
+
+//stops cycling through the candidates. They are kept around in case the next tab can narrow them down
+void TERM_endCompletion(TERMINAL_HANDLE * handle){
+    handle->currAutocompleteCount = 0;
+    handle->autocompleteActive = 0;
+}
+
+void TERM_clearCompletion(TERMINAL_HANDLE * handle){
+    if(handle->autocompleteBuffer != NULL) TERM_FREE(handle->autocompleteBuffer);
+    handle->autocompleteBuffer = NULL;
+    handle->autocompleteNode = NULL;
+    handle->autocompleteSlice = NULL;
+    handle->autocompleteBufferLength = 0;
+    handle->currAutocompleteCount = 0;
+    handle->autocompleteStart = 0;
+    handle->autocompleteActive = 0;
+    handle->autocompleteLineLength = 0;
+    handle->autocompleteVersion = NULL;
+}
+
+uint32_t TERM_findMatchingCMDs(char * currInput, uint8_t length, char ** buff, TermCommandDescriptor * cmdListHead){
     
     //TODO handle auto complete of parameters, for now we return if this is attempted
     if(strnchr(currInput, ' ', length) != NULL) return 0;
     //UART_print("scanning \"%s\" for matching cmds\r\n", currInput);
     
-    uint8_t currPos = 0;
-    uint8_t commandsFound = 0;
-    TermCommandDescriptor * currCMD = cmdListHead->nextCmd;
+    //the iterator returns the commands sorted, so all matching ones are next to each other
+    uint32_t commandsFound = 0;
+    TermCommandIterator iterator;
+    TERM_initCommandIterator(&iterator, cmdListHead);
+    const TermCommandDescriptor * currCMD;
     
-    for(;currPos < cmdListHead->commandLength; currPos++){
+    while((currCMD = TERM_nextCommand(&iterator)) != NULL){
         if(strncmp(currInput, currCMD->command, length) == 0){
             if(currCMD->commandLength >= length){
                 buff[commandsFound] = (char*)currCMD->command;
@@ -84,15 +359,16 @@ uint8_t TERM_findMatchingCMDs(char * currInput, uint8_t length, char ** buff, Te
         }else{
             if(commandsFound > 0) return commandsFound;
         }
-        currCMD = currCMD->nextCmd;
     }
     return commandsFound;
 }
 
+//returns where the last argument starts (at its quotation mark if it has one) and copies it into buff. buff can be NULL if the caller only needs its position and length
 uint8_t TERM_findLastArg(TERMINAL_HANDLE * handle, char * buff, uint8_t * lenBuff){
     uint8_t currPos = 0;
     unsigned quoteMark = 0;
     char * lastSpace = 0;
+    TERM_lineGetString(handle);
     for(;currPos<handle->currBufferLength; currPos++){
         switch(handle->inputBuffer[currPos]){
             case ' ':
@@ -116,48 +392,78 @@ uint8_t TERM_findLastArg(TERMINAL_HANDLE * handle, char * buff, uint8_t * lenBuf
     }
     
     *lenBuff = handle->currBufferLength - (lastSpace - handle->inputBuffer) - 1;
-    memcpy(buff, lastSpace + 1, *lenBuff + 1);
+    if(buff != NULL) memcpy(buff, lastSpace + 1, *lenBuff + 1);
     return (lastSpace - handle->inputBuffer) + ((*lastSpace == '"') ? 0 : 1);
 }
 
-uint8_t TERM_doListAC(AC_LIST_HEAD * head, char * currInput, uint8_t length, char ** buff){
-    uint8_t currPos = 0;
-    uint8_t commandsFound = 0;
-    //UART_print("\r\nStart scan\r\n", buff[commandsFound], commandsFound+1);
+//compares element index of head with string like strcmp does
+static int32_t ACL_compare(AC_LIST_HEAD * head, uint32_t index, const char * string, uint32_t length){
+    uint32_t elementLength = head->isConst ? strlen(head->strings[index]) : head->lengths[index];
+    int32_t result = memcmp(head->strings[index], string, (elementLength < length) ? elementLength : length);
+    if(result != 0) return result;
+    return (int32_t) elementLength - (int32_t) length;
+}
+
+//index of string in head, or where it would have to be inserted if it isn't in there (found is set accordingly)
+static uint32_t ACL_search(AC_LIST_HEAD * head, const char * string, uint32_t length, unsigned * found){
+    uint32_t low = 0;
+    uint32_t high = head->elementCount;
+    *found = 0;
     
-    if(head->isConst){
-        char ** strings = (char **) head->first;
-        
-        for(;currPos < head->elementCount; currPos++){
-            //UART_print("\r\nchecking \"%s\"", strings[currPos]);
-            if(strncmp(currInput, strings[currPos], length) == 0){
-                if(strlen(strings[currPos]) >= length){
-                    buff[commandsFound] = strings[currPos];
-                    commandsFound ++;
-                    //UART_print(" -> found match (count is now %d)", commandsFound);
-                }
-            }else{
-                if(commandsFound > 0) return commandsFound;
-            }
-        }
-        //UART_print("\r\n-----list done-----\r\n");
-    }else{
-        AC_LIST_ELEMENT * curr = head->first;
-        for(;currPos < head->elementCount; currPos++){
-            if(strncmp(currInput, curr->string, length) == 0){
-                if(strlen(curr->string) >= length){
-                    buff[commandsFound] = curr->string;
-                    commandsFound ++;
-                    //UART_print("found %s (count is now %d)\r\n", buff[commandsFound], commandsFound);
-                }
-            }else{
-                if(commandsFound > 0) return commandsFound;
-            }
-            curr = ACL_getNext(curr);
-            if(curr == 0) break;
+    while(low < high){
+        uint32_t mid = low + (high - low) / 2;
+        int32_t result = ACL_compare(head, mid, string, length);
+        if(result == 0){
+            *found = 1;
+            return mid;
         }
+        if(result < 0) low = mid + 1; else high = mid;
     }
-    return commandsFound;
+    return low;
+}
+
+//first string that doesn't sort before currInput (upper = 0) or after all strings starting with it (upper = 1)
+static uint32_t ACL_prefixBound(char * const * strings, uint32_t count, const char * currInput, uint32_t length, unsigned upper){
+    uint32_t low = 0;
+    uint32_t high = count;
+    
+    while(low < high){
+        uint32_t mid = low + (high - low) / 2;
+        int32_t result = strncmp(strings[mid], currInput, length);
+        if(result < 0 || (upper && result == 0)) low = mid + 1; else high = mid;
+    }
+    return low;
+}
+
+//all strings of a sorted array that start with currInput are next to each other, returns how many there are and sets first to the index of the first one
+uint32_t ACL_findSliceRange(char * const * strings, uint32_t count, const char * currInput, uint32_t length, uint32_t * first){
+    *first = ACL_prefixBound(strings, count, currInput, length, 0);
+    return ACL_prefixBound(strings, count, currInput, length, 1) - *first;
+}
+
+uint32_t ACL_findRange(AC_LIST_HEAD * head, const char * currInput, uint32_t length, uint32_t * first){
+    return ACL_findSliceRange(head->strings, head->elementCount, currInput, length, first);
+}
+
+uint8_t TERM_doListAC(AC_LIST_HEAD * head, char * currInput, uint8_t length, char ** buff){
+    uint32_t first;
+    uint32_t count = ACL_findRange(head, currInput, length, &first);
+    if(count > 0xff) count = 0xff;
+    memcpy(buff, &head->strings[first], count * sizeof(char *));
+    return count;
+}
+
+//points the completion of handle to the strings in head that start with currInput. The list is sorted so they are a slice of it and nothing needs to be copied
+uint32_t ACL_complete(TERMINAL_HANDLE * handle, AC_LIST_HEAD * head, const char * currInput, uint32_t length){
+    uint32_t first;
+    handle->autocompleteBufferLength = ACL_findRange(head, currInput, length, &first);
+    handle->autocompleteSlice = (const char * const *) &head->strings[first];
+#if TERM_FUZZY_COMPLETION == 1
+    if(handle->autocompleteBufferLength == 0) TERM_completeFuzzy(handle, head->strings, head->elementCount, currInput, length);
+#endif
+    handle->autocompleteVersion = head->isConst ? NULL : &head->version;
+    handle->autocompleteVersionValue = head->version;
+    return handle->autocompleteBufferLength;
 }
 
 uint8_t ACL_defaultCompleter(TERMINAL_HANDLE * handle, void * params){
@@ -168,34 +474,25 @@ uint8_t ACL_defaultCompleter(TERMINAL_HANDLE * handle, void * params){
     
     AC_LIST_HEAD * list = (AC_LIST_HEAD *) params;
     
-    char * buff = TERM_MALLOC(128);
+    //complete the last argument right where it is in the input buffer
     uint8_t len;
-    memset(buff, 0, 128);
-    handle->autocompleteStart = TERM_findLastArg(handle, buff, &len);
-    
-    //TODO use a reasonable size here
-    handle->autocompleteBuffer = TERM_MALLOC(list->elementCount * sizeof(char *));
+    handle->autocompleteStart = TERM_findLastArg(handle, NULL, &len);
     handle->currAutocompleteCount = 0;
-    handle->autocompleteBufferLength = TERM_doListAC(list, buff, len, handle->autocompleteBuffer);
-        
-    TERM_FREE(buff);
+    ACL_complete(handle, list, &handle->inputBuffer[handle->currBufferLength - len], len);
     return handle->autocompleteBufferLength;
 }
 
-AC_LIST_ELEMENT * ACL_getNext(AC_LIST_ELEMENT * currElement){
-    return currElement->next;
-}
-
 AC_LIST_HEAD * ACL_create(){
     AC_LIST_HEAD * ret = TERM_MALLOC(sizeof(AC_LIST_HEAD));
-    ret->elementCount = 0;
-    ret->first = 0;
-    ret->isConst = 0;
+    if(ret == NULL) return NULL;
+    memset(ret, 0, sizeof(AC_LIST_HEAD));
     return ret;
 }
 
 AC_LIST_HEAD * ACL_createConst(char ** strings, uint32_t count){
     AC_LIST_HEAD * ret = TERM_MALLOC(sizeof(AC_LIST_HEAD));
+    if(ret == NULL) return NULL;
+    memset(ret, 0, sizeof(AC_LIST_HEAD));
     
     if(count == 0){  //autocount (requires "__LIST_END__" string)
         uint32_t currCount = 0;
@@ -205,121 +502,79 @@ AC_LIST_HEAD * ACL_createConst(char ** strings, uint32_t count){
         ret->elementCount = count;
     }
     
-    ret->first = (AC_LIST_ELEMENT *) strings;
+    ret->strings = strings;
     ret->isConst = 1;
     return (AC_LIST_HEAD *) ret;
 }
 
-AC_LIST_ELEMENT * ACL_find(AC_LIST_HEAD * head, char * string){
-    if(head->elementCount == 0) return 0;
-    uint32_t currPos = 0;
-    AC_LIST_ELEMENT * currComp = head->first;
+char * ACL_find(AC_LIST_HEAD * head, char * string){
+    unsigned found;
+    uint32_t index = ACL_search(head, string, strlen(string), &found);
+    return found ? head->strings[index] : 0;
+}
+
+//makes room for at least one more element in a non const list
+static unsigned ACL_grow(AC_LIST_HEAD * head){
+    if(head->elementCount < head->size) return 1;
     
-    for(;currPos < head->elementCount; currPos++){
-        if((strlen(currComp->string) == strlen(string)) && (strcmp(currComp->string, string) == 0)){
-            return currComp;
-        }
-        if(currComp->next == 0) return 0;
-        currComp = currComp->next;
+    uint32_t newSize = (head->size == 0) ? ACL_INITIAL_SIZE : head->size * 2;
+    char ** newStrings = TERM_MALLOC(newSize * sizeof(char *));
+    uint16_t * newLengths = TERM_MALLOC(newSize * sizeof(uint16_t));
+    if(newStrings == NULL || newLengths == NULL){
+        if(newStrings != NULL) TERM_FREE(newStrings);
+        if(newLengths != NULL) TERM_FREE(newLengths);
+        return 0;
     }
-    return 0;
+    
+    if(head->size != 0){
+        memcpy(newStrings, head->strings, head->elementCount * sizeof(char *));
+        memcpy(newLengths, head->lengths, head->elementCount * sizeof(uint16_t));
+        TERM_FREE(head->strings);
+        TERM_FREE(head->lengths);
+    }
+    
+    head->strings = newStrings;
+    head->lengths = newLengths;
+    head->size = newSize;
+    return 1;
 }
 
 void ACL_add(AC_LIST_HEAD * head, char * string){
-    if(head->isConst || ACL_find(head, string) != 0) return;
-    
-    if(head->elementCount == 0){
-        AC_LIST_ELEMENT * newElement = TERM_MALLOC(sizeof(AC_LIST_ELEMENT));
-        newElement->string = string;
-        newElement->next = 0;
-        head->first = newElement;
-        head->elementCount ++;
-        return;
-    }
+    uint32_t length = strlen(string);
+    if(head->isConst || length > 0xffff) return;
     
-    uint32_t currPos = 0;
-    AC_LIST_ELEMENT ** lastComp = &head->first;
-    AC_LIST_ELEMENT * currComp = head->first;
+    unsigned found;
+    uint32_t index = ACL_search(head, string, length, &found);
+    if(found || !ACL_grow(head)) return;
     
-    while(currPos < head->elementCount){
-        if(ACL_isSorted(currComp->string, string)){
-            AC_LIST_ELEMENT * newElement = TERM_MALLOC(sizeof(AC_LIST_ELEMENT));
-            newElement->string = string;
-
-            *lastComp = newElement;
-            newElement->next = currComp;
-
-            head->elementCount ++;
-            
-            break;
-        }
-        if(currComp->next == 0){
-            AC_LIST_ELEMENT * newElement = TERM_MALLOC(sizeof(AC_LIST_ELEMENT));
-            newElement->string = string;
-            newElement->string = string;
-            newElement->next = currComp->next;
-            currComp->next = newElement;
-            head->elementCount ++;
-            return;
-        }
-        lastComp = &currComp->next;
-        currComp = currComp->next;
-    }
+    memmove(&head->strings[index + 1], &head->strings[index], (head->elementCount - index) * sizeof(char *));
+    memmove(&head->lengths[index + 1], &head->lengths[index], (head->elementCount - index) * sizeof(uint16_t));
+    head->strings[index] = string;
+    head->lengths[index] = length;
+    head->elementCount ++;
+    head->version ++;
 }
 
-
-
 void ACL_remove(AC_LIST_HEAD * head, char * string){
     if(head->isConst || head->elementCount == 0) return;
-    uint32_t currPos = 0;
-    AC_LIST_ELEMENT ** lastComp = &head->first;
-    AC_LIST_ELEMENT * currComp = head->first;
-    
-    for(;currPos < head->elementCount; currPos++){
-        if((strlen(currComp->string) == strlen(string)) && (strcmp(currComp->string, string) == 0)){
-            *lastComp = currComp->next;
-            
-            //TODO reimplement this. currently this leaks memory
-            /*if(ptr_is_in_ram(currComp->string)){
-                TERM_FREE(currComp->string);
-            }*/
-            
-            TERM_FREE(currComp);
-            head->elementCount --;
-            return;
-        }
-        if(currComp->next == 0) break;
-        lastComp = &currComp->next;
-        currComp = currComp->next;
-    }
+    
+    unsigned found;
+    uint32_t index = ACL_search(head, string, strlen(string), &found);
+    if(!found) return;
+    
+    //TODO reimplement this. currently this leaks memory
+    /*if(ptr_is_in_ram(head->strings[index])){
+        TERM_FREE(head->strings[index]);
+    }*/
+    
+    head->elementCount --;
+    head->version ++;
+    memmove(&head->strings[index], &head->strings[index + 1], (head->elementCount - index) * sizeof(char *));
+    memmove(&head->lengths[index], &head->lengths[index + 1], (head->elementCount - index) * sizeof(uint16_t));
 }
 
+//returns 1 if b belongs in front of a (or they are identical), in the same strcmp order ACL_search expects the lists to be in
 unsigned ACL_isSorted(char * a, char * b){
-    uint8_t currPos = 0;
-    uint32_t aLength = strlen(a);
-    uint32_t bLength = strlen(b);
-    
-    //compare the lowercase ASCII values of each character in the command (They are alphabetically sorted)
-    for(;currPos < aLength && currPos < bLength; currPos++){
-        char letterA = toLowerCase(a[currPos]);
-        char letterB = toLowerCase(b[currPos]);
-        //if the letters are different we return 1 if a is smaller than b (they are correctly sorted) or zero if its the other way around
-        if(letterA > letterB){
-            return 1;
-        }else if(letterB > letterA){
-            return 0;
-        }
-    }
-    
-    //the two commands have identical letters for their entire length we check which one is longer (the shortest should come first)
-    if(aLength > bLength){
-        return 1;
-    }else if(bLength > aLength){
-        return 0;
-    }else{
-        //it might happen that a command is added twice (or two identical ones are added), in which case we just say they are sorted correctly and print an error in the console
-        //TODO implement an alarm here
-        //UART_print("WARNING: Found identical commands: \"%S\" and \"%S\"\r\n", a, b);
-        return 1;
-    }
+    //it might happen that a string is added twice, in which case we just say they are sorted correctly
+    return strcmp(a, b) >= 0;
 }
@@ -0,0 +1,416 @@
+/*
+ * TTerm
+ *
+ * Copyright (c) 2020 Thorben Zethoff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+    
+#if PIC32 == 1
+#include <xc.h>
+#endif  
+#include <stdint.h>
+#include <string.h>
+
+#include "TTerm_VT100.h"
+
+//byte classes the decoder distinguishes between
+enum{
+    CC_CTRL,        //0x00-0x1f except ESC
+    CC_ESC,         //0x1b
+    CC_INTER,       //0x20-0x2f intermediate bytes
+    CC_DIGIT,       //0-9
+    CC_SEP,         //; and : parameter separators
+    CC_PRIV,        //< = > ? private markers
+    CC_BRACKET,     //[
+    CC_SS3,         //O
+    CC_RESET,       //c
+    CC_FINAL,       //everything else in 0x40-0x7e
+    CC_DEL,         //0x7f
+    CC_HIGH,        //0x80-0xff
+    CC_COUNT
+};
+
+//decoder states
+enum{
+    ST_GROUND,
+    ST_ESC,
+    ST_CSI,
+    ST_SS3,
+    ST_IGNORE,      //swallows the rest of a sequence we don't care about up to its final byte
+    ST_COUNT
+};
+
+//what to do with a byte when taking a transition
+enum{
+    AC_NONE,
+    AC_KEY,             //pass the byte on as it is
+    AC_ESC,             //pass on a lone ESC
+    AC_ESC_KEY,         //pass on ESC and then the byte
+    AC_RESET,           //ESC c
+    AC_CLEAR,           //start of a new sequence, reset parameters
+    AC_PARAM,           //add a digit to the current parameter
+    AC_NEXT_PARAM,
+    AC_PRIVATE,
+    AC_CSI_DISPATCH,
+    AC_SS3_DISPATCH
+};
+
+#define TR(action, state) (((action) << 3) | (state))
+#define TR_STATE(tr) ((tr) & 0x7)
+#define TR_ACTION(tr) ((tr) >> 3)
+
+static const uint8_t TERM_VT100_transitions[ST_COUNT][CC_COUNT] = {
+    //              CTRL                        ESC                     INTER                       DIGIT                       SEP                         PRIV                        BRACKET                     SS3                             RESET                           FINAL                           DEL                     HIGH
+    [ST_GROUND] = { TR(AC_KEY, ST_GROUND),      TR(AC_NONE, ST_ESC),    TR(AC_KEY, ST_GROUND),      TR(AC_KEY, ST_GROUND),      TR(AC_KEY, ST_GROUND),      TR(AC_KEY, ST_GROUND),      TR(AC_KEY, ST_GROUND),      TR(AC_KEY, ST_GROUND),          TR(AC_KEY, ST_GROUND),          TR(AC_KEY, ST_GROUND),          TR(AC_KEY, ST_GROUND),  TR(AC_KEY, ST_GROUND) },
+    [ST_ESC]    = { TR(AC_ESC_KEY, ST_GROUND),  TR(AC_ESC, ST_ESC),     TR(AC_ESC_KEY, ST_GROUND),  TR(AC_ESC_KEY, ST_GROUND),  TR(AC_ESC_KEY, ST_GROUND),  TR(AC_ESC_KEY, ST_GROUND),  TR(AC_CLEAR, ST_CSI),       TR(AC_CLEAR, ST_SS3),           TR(AC_RESET, ST_GROUND),        TR(AC_ESC_KEY, ST_GROUND),      TR(AC_ESC_KEY, ST_GROUND), TR(AC_ESC_KEY, ST_GROUND) },
+    [ST_CSI]    = { TR(AC_KEY, ST_CSI),         TR(AC_NONE, ST_ESC),    TR(AC_NONE, ST_IGNORE),     TR(AC_PARAM, ST_CSI),       TR(AC_NEXT_PARAM, ST_CSI),  TR(AC_PRIVATE, ST_CSI),     TR(AC_NONE, ST_IGNORE),     TR(AC_CSI_DISPATCH, ST_GROUND), TR(AC_CSI_DISPATCH, ST_GROUND), TR(AC_CSI_DISPATCH, ST_GROUND), TR(AC_NONE, ST_CSI),    TR(AC_NONE, ST_GROUND) },
+    [ST_SS3]    = { TR(AC_KEY, ST_SS3),         TR(AC_NONE, ST_ESC),    TR(AC_NONE, ST_GROUND),     TR(AC_PARAM, ST_SS3),       TR(AC_NONE, ST_SS3),        TR(AC_NONE, ST_GROUND),     TR(AC_NONE, ST_GROUND),     TR(AC_SS3_DISPATCH, ST_GROUND), TR(AC_SS3_DISPATCH, ST_GROUND), TR(AC_SS3_DISPATCH, ST_GROUND), TR(AC_NONE, ST_GROUND), TR(AC_NONE, ST_GROUND) },
+    [ST_IGNORE] = { TR(AC_KEY, ST_IGNORE),      TR(AC_NONE, ST_ESC),    TR(AC_NONE, ST_IGNORE),     TR(AC_NONE, ST_IGNORE),     TR(AC_NONE, ST_IGNORE),     TR(AC_NONE, ST_IGNORE),     TR(AC_NONE, ST_GROUND),     TR(AC_NONE, ST_GROUND),         TR(AC_NONE, ST_GROUND),         TR(AC_NONE, ST_GROUND),         TR(AC_NONE, ST_IGNORE), TR(AC_NONE, ST_GROUND) },
+};
+
+//class of every possible input byte
+static const uint8_t TERM_VT100_byteClass[256] = {
+    [0x00 ... 0x1a] = CC_CTRL,
+    [0x1b] = CC_ESC,
+    [0x1c ... 0x1f] = CC_CTRL,
+    [0x20 ... 0x2f] = CC_INTER,
+    [0x30 ... 0x39] = CC_DIGIT,
+    [':' ... ';'] = CC_SEP,
+    ['<' ... '?'] = CC_PRIV,
+    ['@' ... 'N'] = CC_FINAL,
+    ['O'] = CC_SS3,
+    ['P' ... 'Z'] = CC_FINAL,
+    ['['] = CC_BRACKET,
+    ['\\' ... 'b'] = CC_FINAL,
+    ['c'] = CC_RESET,
+    ['d' ... '~'] = CC_FINAL,
+    [0x7f] = CC_DEL,
+    [0x80 ... 0xff] = CC_HIGH
+};
+
+//key for the final byte of CSI/SS3 sequences (ESC[A, ESCOA, ESC[1;5A etc.). 0 means we don't care about it
+static const uint16_t TERM_VT100_finalKeys[0x3f] = {
+    ['A' - 0x40] = _VT100_CURSOR_UP,
+    ['B' - 0x40] = _VT100_CURSOR_DOWN,
+    ['C' - 0x40] = _VT100_CURSOR_FORWARD,
+    ['D' - 0x40] = _VT100_CURSOR_BACK,
+    ['F' - 0x40] = _VT100_KEY_END,
+    ['H' - 0x40] = _VT100_KEY_POS1,
+    ['M' - 0x40] = '\r',                //keypad enter in application mode
+    ['P' - 0x40] = _VT100_KEY_F1,
+    ['Q' - 0x40] = _VT100_KEY_F2,
+    ['R' - 0x40] = _VT100_KEY_F3,
+    ['S' - 0x40] = _VT100_KEY_F4,
+    ['Z' - 0x40] = _VT100_BACKWARDS_TAB
+};
+
+//key for ESC[{keyID}~ sequences, indexed by the keyID
+static const uint16_t TERM_VT100_tildeKeys[25] = {
+    [1] = _VT100_KEY_POS1,
+    [2] = _VT100_KEY_INS,
+    [3] = _VT100_KEY_DEL,
+    [4] = _VT100_KEY_END,
+    [5] = _VT100_KEY_PAGE_UP,
+    [6] = _VT100_KEY_PAGE_DOWN,
+    [7] = _VT100_KEY_POS1,
+    [8] = _VT100_KEY_END,
+    [11] = _VT100_KEY_F1,
+    [12] = _VT100_KEY_F2,
+    [13] = _VT100_KEY_F3,
+    [14] = _VT100_KEY_F4,
+    [15] = _VT100_KEY_F5,
+    [17] = _VT100_KEY_F6,
+    [18] = _VT100_KEY_F7,
+    [19] = _VT100_KEY_F8,
+    [20] = _VT100_KEY_F9,
+    [21] = _VT100_KEY_F10,
+    [23] = _VT100_KEY_F11,
+    [24] = _VT100_KEY_F12
+};
+
+//xterm style modifier parameter (1 + bitmask of shift=1, alt=2, ctrl=4) to our flags
+static const uint16_t TERM_VT100_modifiers[8] = {
+    0,
+    _VT100_MOD_SHIFT,
+    _VT100_MOD_ALT,
+    _VT100_MOD_SHIFT | _VT100_MOD_ALT,
+    _VT100_MOD_CTRL,
+    _VT100_MOD_CTRL | _VT100_MOD_SHIFT,
+    _VT100_MOD_CTRL | _VT100_MOD_ALT,
+    _VT100_MOD_CTRL | _VT100_MOD_SHIFT | _VT100_MOD_ALT
+};
+
+static uint16_t TERM_getVT100Modifier(uint16_t param){
+    //a missing parameter or a 1 both mean "no modifiers"
+    return (param > 1) ? TERM_VT100_modifiers[(param - 1) & 0x7] : 0;
+}
+
+void TERM_initVT100Decoder(TermVT100Decoder * decoder){
+    memset(decoder, 0, sizeof(TermVT100Decoder));
+    decoder->state = ST_GROUND;
+}
+
+//returns 1 if the decoder isn't in the middle of a sequence
+unsigned TERM_isVT100DecoderIdle(TermVT100Decoder * decoder){
+    return decoder->state == ST_GROUND;
+}
+
+//makes the decoder treat the next ESC[{row};{column}R as a cursor position report instead of a (shift+)F3 key, which looks exactly the same
+void TERM_expectVT100CursorReport(TermVT100Decoder * decoder){
+    decoder->cursorReportPending = 1;
+}
+
+//feeds one byte into the decoder. Writes the keys it completed (if any) into keys and returns how many there were (0 to TERM_VT100_MAX_KEYS_PER_BYTE)
+uint32_t TERM_decodeVT100(TermVT100Decoder * decoder, uint8_t c, uint16_t * keys){
+    uint8_t transition = TERM_VT100_transitions[decoder->state][TERM_VT100_byteClass[c]];
+    decoder->state = TR_STATE(transition);
+    
+    uint16_t key;
+    switch(TR_ACTION(transition)){
+        case AC_KEY:
+            keys[0] = c;
+            return 1;
+            
+        case AC_ESC:
+            keys[0] = 0x1b;
+            return 1;
+            
+        case AC_ESC_KEY:
+            keys[0] = 0x1b;
+            keys[1] = c;
+            return 2;
+            
+        case AC_RESET:
+            keys[0] = _VT100_RESET;
+            return 1;
+            
+        case AC_CLEAR:
+            memset(decoder->params, 0, sizeof(decoder->params));
+            decoder->paramIndex = 0;
+            decoder->privateMarker = 0;
+            return 0;
+            
+        case AC_PARAM:
+            //digits past the last parameter we keep are dropped, values saturate instead of overflowing
+            if(decoder->paramIndex < TERM_VT100_MAX_PARAMS){
+                uint16_t * param = &decoder->params[decoder->paramIndex];
+                *param = (*param > 6552) ? 0xffff : *param * 10 + (c - '0');
+            }
+            return 0;
+            
+        case AC_NEXT_PARAM:
+            if(decoder->paramIndex < TERM_VT100_MAX_PARAMS) decoder->paramIndex++;
+            return 0;
+            
+        case AC_PRIVATE:
+            decoder->privateMarker = c;
+            return 0;
+            
+        case AC_CSI_DISPATCH:
+            //private sequences (ESC[?...) are reports from the terminal, not keys
+            if(decoder->privateMarker != 0) return 0;
+            
+            //answer to ESC[6n? The position is left in params[0] (row) and params[1] (column)
+            if(c == 'R' && decoder->cursorReportPending && decoder->paramIndex == 1){
+                decoder->cursorReportPending = 0;
+                keys[0] = _VT100_CURSOR_REPORT;
+                return 1;
+            }
+            
+            if(c == '~'){
+                if(decoder->params[0] < sizeof(TERM_VT100_tildeKeys) / sizeof(uint16_t)){
+                    key = TERM_VT100_tildeKeys[decoder->params[0]];
+                }else if(decoder->params[0] == 200 || decoder->params[0] == 201){
+                    //bracketed paste markers (ESC[200~ and ESC[201~)
+                    key = (decoder->params[0] == 200) ? _VT100_PASTE_START : _VT100_PASTE_END;
+                    keys[0] = key;
+                    return 1;
+                }else{
+                    key = 0;
+                }
+                if(key == 0) key = _VT100_INVALID;
+            }else{
+                key = TERM_VT100_finalKeys[c - 0x40];
+                if(key == 0) return 0;
+            }
+            
+            //ESC[{keyID};{modifier}~ or ESC[1;{modifier}{final}
+            if(key != _VT100_INVALID && key > 0xff) key |= TERM_getVT100Modifier(decoder->params[1]);
+            keys[0] = key;
+            return 1;
+            
+        case AC_SS3_DISPATCH:
+            key = TERM_VT100_finalKeys[c - 0x40];
+            if(key == 0) return 0;
+            
+            //some terminals put the modifier right after the O (ESCO5C)
+            if(key > 0xff) key |= TERM_getVT100Modifier(decoder->params[0]);
+            keys[0] = key;
+            return 1;
+            
+        default:
+            return 0;
+    }
+}
+
+//output sequences
+
+typedef struct{
+    const char *    sequence;       //complete sequence or NULL if the code takes a parameter
+    uint8_t         length;
+    uint8_t         paramOffset;    //added to the parameter before it is printed (colors)
+    char            final;          //character after the number of a parametrised code
+} TermVT100Sequence;
+
+#define SEQ(str) { str, sizeof(str) - 1, 0, 0 }
+#define SEQ_PARAM(offset, finalChar) { NULL, 0, offset, finalChar }
+
+static const TermVT100Sequence TERM_VT100_sequences[] = {
+    [_VT100_CURSOR_POS1]                = SEQ("\x1b[H"),
+    [_VT100_CURSOR_END]                 = SEQ("\x1b[F"),
+    [_VT100_FOREGROUND_COLOR]           = SEQ_PARAM(30, 'm'),
+    [_VT100_BACKGROUND_COLOR]           = SEQ_PARAM(40, 'm'),
+    [_VT100_RESET_ATTRIB]               = SEQ("\x1b[0m"),
+    [_VT100_BRIGHT]                     = SEQ("\x1b[1m"),
+    [_VT100_DIM]                        = SEQ("\x1b[2m"),
+    [_VT100_UNDERSCORE]                 = SEQ("\x1b[4m"),
+    [_VT100_BLINK]                      = SEQ("\x1b[5m"),
+    [_VT100_REVERSE]                    = SEQ("\x1b[7m"),
+    [_VT100_HIDDEN]                     = SEQ("\x1b[8m"),
+    [_VT100_ERASE_SCREEN]               = SEQ("\x1b[2J"),
+    [_VT100_ERASE_LINE]                 = SEQ("\x1b[2K"),
+    [_VT100_FONT_G0]                    = SEQ("\x1b("),
+    [_VT100_FONT_G1]                    = SEQ("\x1b)"),
+    [_VT100_WRAP_ON]                    = SEQ("\x1b[?7h"),
+    [_VT100_WRAP_OFF]                   = SEQ("\x1b[?7l"),
+    [_VT100_ERASE_LINE_END]             = SEQ("\x1b[K"),
+    [_VT100_CURSOR_BACK_BY]             = SEQ_PARAM(0, 'D'),
+    [_VT100_CURSOR_FORWARD_BY]          = SEQ_PARAM(0, 'C'),
+    [_VT100_CURSOR_DOWN_BY]             = SEQ_PARAM(0, 'B'),
+    [_VT100_CURSOR_UP_BY]               = SEQ_PARAM(0, 'A'),
+    [_VT100_CURSOR_SAVE_POSITION]       = SEQ("\x1b" "7"),
+    [_VT100_CURSOR_RESTORE_POSITION]    = SEQ("\x1b" "8"),
+    [_VT100_CURSOR_ENABLE]              = SEQ("\x1b[?25h"),
+    [_VT100_CURSOR_DISABLE]             = SEQ("\x1b[?25l"),
+    [_VT100_CLS]                        = SEQ("\x1b[2J\x1b[1;1H"),
+    [_VT100_BRACKETED_PASTE_ON]         = SEQ("\x1b[?2004h"),
+    [_VT100_BRACKETED_PASTE_OFF]        = SEQ("\x1b[?2004l"),
+    [_VT100_INSERT_CHAR]                = SEQ_PARAM(0, '@'),
+    [_VT100_DELETE_CHAR]                = SEQ_PARAM(0, 'P')
+};
+
+//the input key codes can be sent back out as well
+static const TermVT100Sequence TERM_VT100_reset = SEQ("\x1b" "c");
+static const TermVT100Sequence TERM_VT100_cursorBack = SEQ("\x1b[D");
+static const TermVT100Sequence TERM_VT100_cursorForward = SEQ("\x1b[C");
+
+//precomputed colors for TERM_getVT100Code, which has to return a constant string
+static const char TERM_VT100_colors[2][8][6] = {
+    { "\x1b[30m", "\x1b[31m", "\x1b[32m", "\x1b[33m", "\x1b[34m", "\x1b[35m", "\x1b[36m", "\x1b[37m" },
+    { "\x1b[40m", "\x1b[41m", "\x1b[42m", "\x1b[43m", "\x1b[44m", "\x1b[45m", "\x1b[46m", "\x1b[47m" }
+};
+
+static const TermVT100Sequence * TERM_findVT100Sequence(uint16_t cmd){
+    if(cmd < sizeof(TERM_VT100_sequences) / sizeof(TermVT100Sequence)) return &TERM_VT100_sequences[cmd];
+    switch(cmd){
+        case _VT100_RESET:
+            return &TERM_VT100_reset;
+        case _VT100_CURSOR_BACK:
+            return &TERM_VT100_cursorBack;
+        case _VT100_CURSOR_FORWARD:
+            return &TERM_VT100_cursorForward;
+        default:
+            return NULL;
+    }
+}
+
+//writes the decimal representation of value to buffer and returns the number of digits. No division if the value is a single digit, which most are
+static uint32_t TERM_VT100_itoa(char * buffer, uint16_t value){
+    if(value < 10){
+        buffer[0] = '0' + value;
+        return 1;
+    }
+    
+    char digits[5];
+    uint32_t count = 0;
+    while(value){
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    }
+    for(uint32_t i = 0; i < count; i++) buffer[i] = digits[count - 1 - i];
+    return count;
+}
+
+//returns the sequence for cmd and stores its length in *length (0 for unknown codes). Fixed sequences are returned straight from flash, parametrised ones get built in buffer, which needs to be TERM_VT100_MAX_SEQUENCE_LENGTH bytes long
+const char * TERM_getVT100Sequence(uint16_t cmd, uint16_t var, char * buffer, uint32_t * length){
+    const TermVT100Sequence * seq = TERM_findVT100Sequence(cmd);
+    if(seq == NULL || (seq->sequence == NULL && seq->final == 0)){
+        *length = 0;
+        return "";
+    }
+    
+    if(seq->sequence != NULL){
+        *length = seq->length;
+        return seq->sequence;
+    }
+    
+    buffer[0] = 0x1b;
+    buffer[1] = '[';
+    uint32_t pos = 2 + TERM_VT100_itoa(&buffer[2], var + seq->paramOffset);
+    buffer[pos++] = seq->final;
+    *length = pos;
+    return buffer;
+}
+
+//builds ESC[{y};{x}H into buffer and returns its length. x and y are 1 based like the terminal expects them, if one of them is _VT100_POS_IGNORE only the other one is changed
+uint32_t TERM_formatVT100CursorPos(char * buffer, uint16_t x, uint16_t y){
+    if(x == _VT100_POS_IGNORE && y == _VT100_POS_IGNORE) return 0;
+    
+    buffer[0] = 0x1b;
+    buffer[1] = '[';
+    uint32_t pos = 2;
+    
+    if(x == _VT100_POS_IGNORE){
+        //vertical position absolute
+        pos += TERM_VT100_itoa(&buffer[pos], y);
+        buffer[pos++] = 'd';
+    }else if(y == _VT100_POS_IGNORE){
+        //cursor horizontal absolute
+        pos += TERM_VT100_itoa(&buffer[pos], x);
+        buffer[pos++] = 'G';
+    }else{
+        pos += TERM_VT100_itoa(&buffer[pos], y);
+        buffer[pos++] = ';';
+        pos += TERM_VT100_itoa(&buffer[pos], x);
+        buffer[pos++] = 'H';
+    }
+    return pos;
+}
+
+//returns a constant string for the requested VT100 code, so it can be used in printf without needing any free() call afterwards. Codes that take a number other than a color return ""
+const char * TERM_getVT100Code(uint16_t cmd, uint8_t var){
+    if(cmd == _VT100_FOREGROUND_COLOR || cmd == _VT100_BACKGROUND_COLOR){
+        //out of range colors used to end up black
+        return TERM_VT100_colors[cmd == _VT100_BACKGROUND_COLOR][(var < 8) ? var : 0];
+    }
+    
+    const TermVT100Sequence * seq = TERM_findVT100Sequence(cmd);
+    if(seq == NULL || seq->sequence == NULL) return "";
+    return seq->sequence;
+}
@@ -40,7 +40,9 @@
 //#include "system.h"
 //#include "UART.h"
 
-AC_LIST_HEAD * head;
+//completion list of the test command. Statically allocated so the command can be in flash too
+AC_LIST_HEAD CMD_testACL = {.isConst = 0, .elementCount = 0, .strings = 0};
+AC_LIST_HEAD * head = &CMD_testACL;
 
 uint8_t CMD_testCommandHandler(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
     uint8_t currArg = 0;
@@ -121,6 +123,10 @@ uint8_t CMD_testCommandHandler(TERMINAL_HANDLE * handle, uint8_t argCount, char
         }else if(strcmp(args[currArg], "-aa") == 0){
             if(++currArg < argCount){
                 char * newString = TERM_MALLOC(strlen(args[currArg])+1);
+                if(newString == NULL){
+                    ttprintf("no memory for the ACL element\r\n");
+                    return TERM_CMD_EXIT_ERROR;
+                }
                 strcpy(newString, args[currArg]);
                 ACL_add(head, newString);
                 ttprintf("Added \"%s\" to the ACL\r\n", args[currArg]);
@@ -136,7 +142,7 @@ uint8_t CMD_testCommandHandler(TERMINAL_HANDLE * handle, uint8_t argCount, char
             char * name = ttgetline(portMAX_DELAY);
             ttprintf(" ok!\r\n");
             ttprintf("Hello %s :)\r\n", name);
-            TERM_FREE(name);
+            TERM_freeLine(name);
             returnCode = TERM_CMD_EXIT_SUCCESS;
         }else if(strcmp(args[currArg], "-iI") == 0){
             uint32_t chip = 0;
@@ -145,7 +151,7 @@ uint8_t CMD_testCommandHandler(TERMINAL_HANDLE * handle, uint8_t argCount, char
                 char * id = ttgetline(portMAX_DELAY);
                 ttprintf("\r\n");
                 chip = atoi(id);
-                TERM_FREE(id);
+                TERM_freeLine(id);
                 if(chip == 6581 || chip == 8580 || chip == 42){
                     break;
                 }else{
@@ -185,20 +191,7 @@ uint8_t TERM_testCommandAutoCompleter(TERMINAL_HANDLE * handle, void * params){
         return 0;
     }
     
-    char * buff = TERM_MALLOC(128);
-    uint8_t len;
-    memset(buff, 0, 128);
-    handle->autocompleteStart = TERM_findLastArg(handle, buff, &len);
-    
-    //TODO use a reasonable size here
-    handle->autocompleteBuffer = TERM_MALLOC(list->elementCount * sizeof(char *));
-    handle->currAutocompleteCount = 0;
-    handle->autocompleteBufferLength = TERM_doListAC(list, buff, len, handle->autocompleteBuffer);
-
-    //UART_print("\r\ncompleting \"%s\" (len = %d, matching = %d) will delete until %d\r\n", buff, len, handle->autocompleteBufferLength, handle->autocompleteStart);
-        
-    TERM_FREE(buff);
-    return handle->autocompleteBufferLength;
+    return ACL_defaultCompleter(handle, params);
 }
 
 #ifdef TERM_RESET_FUNCTION
@@ -217,12 +210,15 @@ uint8_t CMD_help(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
             return TERM_CMD_EXIT_SUCCESS;
         }
     }
-    ttprintf("\r\nTTerm %s\r\n%d Commands available:\r\n\r\n", TERM_VERSION_STRING, handle->cmdListHead->commandLength);
+    ttprintf("\r\nTTerm %s\r\n%d Commands available:\r\n\r\n", TERM_VERSION_STRING, TERM_getCommandCount(handle->cmdListHead));
     ttprintf("\x1b[%dC%s\r\x1b[%dC%s\r\n\r\n", 2, "Command:", 19, "Description:");
-    TermCommandDescriptor * currCmd = handle->cmdListHead->nextCmd;
-    while(currCmd != 0){
-        ttprintf("\x1b[%dC%s\r\x1b[%dC%s\r\n", 3, currCmd->command, 20, currCmd->commandDescription);
-        currCmd = currCmd->nextCmd;
+    //cut descriptions off at the edge of the terminal instead of letting them wrap into the next line
+    int32_t descriptionWidth = (handle->termColumns > 21) ? handle->termColumns - 21 : 1;
+    TermCommandIterator iterator;
+    TERM_initCommandIterator(&iterator, handle->cmdListHead);
+    const TermCommandDescriptor * currCmd;
+    while((currCmd = TERM_nextCommand(&iterator)) != NULL){
+        ttprintf("\x1b[%dC%s\r\x1b[%dC%.*s\r\n", 3, currCmd->command, 20, descriptionWidth, currCmd->commandDescription);
     }
     return TERM_CMD_EXIT_SUCCESS;
 }
@@ -242,3 +238,107 @@ uint8_t CMD_cls(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
     
     return TERM_CMD_EXIT_SUCCESS;
 }
+
+#if TERM_CMD_STATS == 1
+uint8_t CMD_cmdstat(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
+    uint8_t currArg = 0;
+    for(;currArg<argCount; currArg++){
+        if(strcmp(args[currArg], "-?") == 0){
+            ttprintf("usage:\r\n\tcmdstat [-reset]\r\n\nlists how much stack every command got and used (in words). Runs on the worker pool are only counted, their stack can't be measured\r\n");
+            return TERM_CMD_EXIT_SUCCESS;
+        }else if(strcmp(args[currArg], "-reset") == 0){
+            TERM_clearCommandStats();
+            ttprintf("statistics cleared\r\n");
+            return TERM_CMD_EXIT_SUCCESS;
+        }
+    }
+    
+    ttprintf("%-16s %6s %6s %6s %6s\r\n", "Command:", "Runs", "Stack", "Last", "Peak");
+    uint32_t currEntry = 0;
+    const TermCommandStats * stats;
+    for(;currEntry < TERM_CMD_STATS_SIZE; currEntry++){
+        if((stats = TERM_getCommandStats(currEntry)) == NULL) continue;
+        ttprintf("%-16s %6d %6d %6d %6d\r\n", stats->command, stats->runs, stats->stackSize, stats->lastUsed, stats->peak);
+    }
+    return TERM_CMD_EXIT_SUCCESS;
+}
+#endif
+
+#if TERM_MAX_JOBS > 0
+//job control. These are run by the terminal itself (see TERM_INLINE_STACKSIZE) as they change what is in its foreground
+
+uint8_t CMD_jobs(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
+    uint8_t currArg = 0;
+    for(;currArg<argCount; currArg++){
+        if(strcmp(args[currArg], "-?") == 0){
+            ttprintf("lists the jobs started with a trailing '&' or stopped with ctrl+z\r\n");
+            return TERM_CMD_EXIT_SUCCESS;
+        }
+    }
+    
+    uint32_t currJob = 1;
+    for(;currJob <= TERM_MAX_JOBS; currJob++){
+        TermJob * job = TERM_getJob(handle, currJob);
+        if(job == NULL) continue;
+        
+        TERM_printJob(handle, job, NULL);
+        ttprintf("\r\n");
+    }
+    return TERM_CMD_EXIT_SUCCESS;
+}
+
+//the job given as "%n" (or just "n"), the one with the highest number if there is none
+static TermJob * CMD_getJobArgument(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
+    if(argCount == 0) return TERM_getLatestJob(handle);
+    
+    char * number = args[0];
+    if(*number == '%') number++;
+    return TERM_getJob(handle, atoi(number));
+}
+
+uint8_t CMD_fg(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
+    if(argCount > 0 && strcmp(args[0], "-?") == 0){
+        ttprintf("usage:\r\n\tfg [%%job]\r\n\nbrings a job to the foreground, prints everything it wrote in the meantime and continues it if it was stopped\r\n");
+        return TERM_CMD_EXIT_SUCCESS;
+    }
+    
+    TermJob * job = CMD_getJobArgument(handle, argCount, args);
+    if(job == NULL){
+        ttprintf("fg: no such job\r\n");
+        return TERM_CMD_EXIT_ERROR;
+    }
+    
+    if(job->state == JOB_DONE){
+        ttprintf("fg: the job has already finished\r\n");
+        return TERM_CMD_EXIT_ERROR;
+    }
+    
+    TERM_printJob(handle, job, "Foreground");
+    ttprintf("\r\n");
+    TERM_foregroundJob(handle, job);
+    
+    //the prompt comes back once the job is done
+    return TERM_CMD_EXIT_PROC_STARTED;
+}
+
+uint8_t CMD_bg(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
+    if(argCount > 0 && strcmp(args[0], "-?") == 0){
+        ttprintf("usage:\r\n\tbg [%%job]\r\n\ncontinues a stopped job in the background\r\n");
+        return TERM_CMD_EXIT_SUCCESS;
+    }
+    
+    TermJob * job = CMD_getJobArgument(handle, argCount, args);
+    if(job == NULL){
+        ttprintf("bg: no such job\r\n");
+        return TERM_CMD_EXIT_ERROR;
+    }
+    
+    if(!TERM_resumeJob(handle, job)){
+        ttprintf("bg: the job isn't stopped\r\n");
+        return TERM_CMD_EXIT_ERROR;
+    }
+    
+    TERM_printJob(handle, job, NULL);
+    return TERM_CMD_EXIT_SUCCESS;
+}
+#endif
@@ -25,10 +25,13 @@
 #ifdef TERM_SUPPORT_CWD
 
 #include "TTerm_cwd.h"
+#include "TTerm_AC.h"
 #include "ff.h"
 
 #include "FreeRTOS.h"
+#include "task.h"
 #include <string.h>
+#include <stdlib.h>
 
 #define BUFFER_SIZE 255
 
@@ -113,6 +116,7 @@ uint8_t CMD_cat(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
             vPortFree(readFilePath);
             f_close(fp);
         }
+        CWD_invalidateListing(filePath);
         vPortFree(filePath);
         vPortFree(buffer);
         ttprintf("%u bytes written\r\n", bytes_sum);
@@ -187,6 +191,7 @@ uint8_t CMD_echo(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
             ttprintf("Error creating file\r\n");
             return TERM_CMD_EXIT_SUCCESS;
         }
+        CWD_invalidateListing(filePath);
         if(argCount==3){  
             conv_esc(args[0]);
             ttprintf(args[0]);
@@ -234,6 +239,9 @@ uint8_t CMD_ls(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
     FRESULT res = f_opendir(&dir, handle->cwdPath);
     FILINFO fno;
     
+    //ls reads the directory anyway, so it is also the way to pick up changes the shell didn't make itself (over ftp for example)
+    CWD_dropListing(handle->cwdPath, strlen(handle->cwdPath));
+    
     if(res == FR_OK){
         while(1){
             //read the next entry
@@ -316,10 +324,280 @@ uint8_t CMD_mkdir(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
     if(res != FR_OK){
         ttprintf("Didn't work (%d) :(\r\n", res);
     }
+    CWD_invalidateListing(dirPath);
     
     vPortFree(dirPath);
     
     return TERM_CMD_EXIT_SUCCESS;
 }
 
+//cache of directory listings for the path completer, so only the first tab in a directory has to wait for the card.
+//Commands that change a directory run in their own tasks while the completions of the terminals point into the listings, so the entries are only changed with the scheduler suspended
+//and the memory of one is only freed once no terminal uses it anymore
+typedef struct{
+    char * path;            //absolute path of the directory, NULL if the entry is unused
+    char ** names;          //sorted entries, directories end in a '/'. The strings are stored right behind the pointers
+    uint32_t count;
+    uint32_t lastUse;
+    uint32_t users;         //terminals whose completion points into names
+    unsigned stale;         //the directory changed, the listing isn't used for new completions anymore
+} CWD_ListingCacheEntry;
+
+static CWD_ListingCacheEntry CWD_listingCache[TERM_CWD_CACHE_SIZE];
+static uint32_t CWD_listingCacheTime = 0;
+
+//changes whenever a listing is dropped, completions pointing into one check it before they reuse their candidates
+static uint32_t CWD_listingCacheVersion = 0;
+
+//compares two paths, ignoring a trailing '/'
+static unsigned CWD_isSamePath(const char * a, uint32_t aLength, const char * b, uint32_t bLength){
+    if(aLength > 1 && a[aLength - 1] == '/') aLength--;
+    if(bLength > 1 && b[bLength - 1] == '/') bLength--;
+    return aLength == bLength && memcmp(a, b, aLength) == 0;
+}
+
+//marks the listing as outdated, whoever uses it next reads the directory again. Scheduler needs to be suspended
+static void CWD_markStale(CWD_ListingCacheEntry * entry){
+    if(entry->path == NULL || entry->stale) return;
+    entry->stale = 1;
+    CWD_listingCacheVersion++;
+}
+
+//drops the cached listing of the directory at path
+void CWD_dropListing(const char * path, uint32_t length){
+    vTaskSuspendAll();
+    uint32_t currEntry = 0;
+    for(;currEntry < TERM_CWD_CACHE_SIZE; currEntry++){
+        CWD_ListingCacheEntry * entry = &CWD_listingCache[currEntry];
+        if(entry->path != NULL && CWD_isSamePath(entry->path, strlen(entry->path), path, length)) CWD_markStale(entry);
+    }
+    xTaskResumeAll();
+}
+
+//drops the cached listing of the directory the file or directory at path (absolute) is in. NULL drops all of them
+void CWD_invalidateListing(const char * path){
+    if(path == NULL){
+        vTaskSuspendAll();
+        uint32_t currEntry = 0;
+        for(;currEntry < TERM_CWD_CACHE_SIZE; currEntry++) CWD_markStale(&CWD_listingCache[currEntry]);
+        xTaskResumeAll();
+        return;
+    }
+    
+    uint32_t length = strlen(path);
+    if(length > 1 && path[length - 1] == '/') length--;
+    while(length > 0 && path[length - 1] != '/') length--;
+    
+    //not an absolute path, we can't tell which directory it is in
+    if(length == 0) return;
+    CWD_dropListing(path, length);
+}
+
+//lets go of the listing the last completion of the terminal pointed into. It is freed if it is outdated and nobody else uses it
+void CWD_releaseListing(TERMINAL_HANDLE * handle){
+    CWD_ListingCacheEntry * entry = handle->cwdListing;
+    if(entry == NULL) return;
+    handle->cwdListing = NULL;
+    
+    char * path = NULL;
+    char ** names = NULL;
+    
+    vTaskSuspendAll();
+    if(--entry->users == 0 && entry->stale){
+        path = entry->path;
+        names = entry->names;
+        entry->path = NULL;
+        entry->names = NULL;
+        entry->count = 0;
+        entry->stale = 0;
+    }
+    xTaskResumeAll();
+    
+    if(path != NULL){
+        vPortFree(path);
+        vPortFree(names);
+    }
+}
+
+static int CWD_compareNames(const void * a, const void * b){
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+//reads the directory at path into entry. Returns 0 if the directory couldn't be read or there wasn't enough memory
+static unsigned CWD_readListing(CWD_ListingCacheEntry * entry, const char * path){
+    DIR dir;
+    FILINFO fno;
+    if(f_opendir(&dir, path) != FR_OK) return 0;
+    
+    //collect the names into a buffer that grows as needed, they are only sorted once the directory was read completely
+    uint32_t size = 256;
+    uint32_t used = 0;
+    uint32_t count = 0;
+    char * names = pvPortMalloc(size);
+    
+    while(names != NULL){
+        if(f_readdir(&dir, &fno) != FR_OK || fno.fname[0] == 0) break;
+        if(fno.fattrib & (AM_HID | AM_SYS)) continue;
+        
+        uint32_t length = strlen(fno.fname);
+        unsigned isDir = (fno.fattrib & AM_DIR) != 0;
+        if(used + length + isDir + 1 > size){
+            while(used + length + isDir + 1 > size) size *= 2;
+            char * newNames = pvPortMalloc(size);
+            if(newNames != NULL) memcpy(newNames, names, used);
+            vPortFree(names);
+            names = newNames;
+            if(names == NULL) break;
+        }
+        
+        memcpy(&names[used], fno.fname, length);
+        used += length;
+        if(isDir) names[used++] = '/';
+        names[used++] = 0;
+        count++;
+    }
+    f_closedir(&dir);
+    if(names == NULL) return 0;
+    
+    //one allocation for the pointers with the strings right behind them
+    entry->names = pvPortMalloc(count * sizeof(char *) + used);
+    entry->path = pvPortMalloc(strlen(path) + 1);
+    if(entry->names == NULL || entry->path == NULL){
+        if(entry->names != NULL) vPortFree(entry->names);
+        if(entry->path != NULL) vPortFree(entry->path);
+        entry->names = NULL;
+        entry->path = NULL;
+        vPortFree(names);
+        return 0;
+    }
+    
+    char * strings = (char *) &entry->names[count];
+    memcpy(strings, names, used);
+    vPortFree(names);
+    
+    uint32_t currName = 0;
+    for(;currName < count; currName++){
+        entry->names[currName] = strings;
+        strings += strlen(strings) + 1;
+    }
+    qsort(entry->names, count, sizeof(char *), CWD_compareNames);
+    
+    strcpy(entry->path, path);
+    entry->count = count;
+    return 1;
+}
+
+//returns the listing of the directory at path (absolute), from the cache if it is in there. The terminal uses it until its next call of this (or CWD_releaseListing)
+static CWD_ListingCacheEntry * CWD_getListing(TERMINAL_HANDLE * handle, const char * path){
+    //the candidates of the last completion are gone already
+    CWD_releaseListing(handle);
+    
+    CWD_ListingCacheEntry * found = NULL;
+    uint32_t pathLength = strlen(path);
+    uint32_t currEntry = 0;
+    
+    vTaskSuspendAll();
+    for(;currEntry < TERM_CWD_CACHE_SIZE; currEntry++){
+        CWD_ListingCacheEntry * entry = &CWD_listingCache[currEntry];
+        if(entry->path != NULL && !entry->stale && CWD_isSamePath(entry->path, strlen(entry->path), path, pathLength)){
+            entry->lastUse = ++CWD_listingCacheTime;
+            entry->users++;
+            found = entry;
+            break;
+        }
+    }
+    xTaskResumeAll();
+    
+    if(found != NULL){
+        handle->cwdListing = found;
+        return found;
+    }
+    
+    //not cached. Reading the card takes a while, so that happens into an entry of our own which is put into the cache afterwards
+    CWD_ListingCacheEntry listing;
+    if(!CWD_readListing(&listing, path)) return NULL;
+    
+    //replace an empty or outdated entry or the one that wasn't used for the longest time. Ones a terminal still points into are kept
+    CWD_ListingCacheEntry old = {.path = NULL};
+    vTaskSuspendAll();
+    for(currEntry = 0; currEntry < TERM_CWD_CACHE_SIZE; currEntry++){
+        CWD_ListingCacheEntry * entry = &CWD_listingCache[currEntry];
+        if(entry->users != 0) continue;
+        if(entry->path == NULL || entry->stale){
+            found = entry;
+            break;
+        }
+        if(found == NULL || entry->lastUse < found->lastUse) found = entry;
+    }
+    if(found != NULL){
+        old = *found;
+        *found = listing;
+        found->lastUse = ++CWD_listingCacheTime;
+        found->users = 1;
+        found->stale = 0;
+    }
+    xTaskResumeAll();
+    
+    if(found == NULL){
+        //every entry is in use by a terminal
+        old = listing;
+    }
+    if(old.path != NULL){
+        vPortFree(old.path);
+        vPortFree(old.names);
+    }
+    
+    handle->cwdListing = found;
+    return found;
+}
+
+//completes the last argument as a path relative to the working directory
+uint8_t CWD_pathCompleter(TERMINAL_HANDLE * handle, void * params){
+    uint8_t length;
+    handle->autocompleteStart = TERM_findLastArg(handle, NULL, &length);
+    handle->currAutocompleteCount = 0;
+    handle->autocompleteBufferLength = 0;
+    
+    char * word = &handle->inputBuffer[handle->currBufferLength - length];
+    char * lastSlash = NULL;
+    uint32_t currPos = 0;
+    for(;currPos < length; currPos++){
+        if(word[currPos] == '/') lastSlash = &word[currPos];
+    }
+    
+    //only the part behind the last '/' gets completed, the part in front of it says in which directory
+    char * path;
+    if(lastSlash == NULL){
+        path = handle->cwdPath;
+    }else{
+        uint32_t dirLength = (lastSlash == word) ? 1 : lastSlash - word;
+        char * dir = pvPortMalloc(dirLength + 1);
+        if(dir == NULL) return 0;
+        memcpy(dir, word, dirLength);
+        dir[dirLength] = 0;
+        path = FS_newCWD(handle->cwdPath, dir);
+        vPortFree(dir);
+        if(path == NULL) return 0;
+        
+        handle->autocompleteStart = (lastSlash + 1) - handle->inputBuffer;
+        length -= (lastSlash + 1) - word;
+        word = lastSlash + 1;
+    }
+    
+    CWD_ListingCacheEntry * listing = CWD_getListing(handle, path);
+    if(path != handle->cwdPath) vPortFree(path);
+    if(listing == NULL) return 0;
+    
+    //the listing is sorted so the matching names are a slice of it
+    uint32_t first;
+    handle->autocompleteBufferLength = ACL_findSliceRange(listing->names, listing->count, word, length, &first);
+    handle->autocompleteSlice = (const char * const *) &listing->names[first];
+    handle->autocompleteVersion = &CWD_listingCacheVersion;
+    handle->autocompleteVersionValue = CWD_listingCacheVersion;
+#if TERM_FUZZY_COMPLETION == 1
+    if(handle->autocompleteBufferLength == 0) TERM_completeFuzzy(handle, listing->names, listing->count, word, length);
+#endif
+    return handle->autocompleteBufferLength;
+}
+
 #endif
@@ -0,0 +1,189 @@
+/*
+ * TTerm
+ *
+ * Copyright (c) 2020 Thorben Zethoff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+    
+#if PIC32 == 1
+#include <xc.h>
+#endif  
+#include <stdint.h>
+#include <string.h>
+
+#include "TTerm.h"
+#include "TTerm_line.h"
+
+#define TERM_LINE_TAIL_LENGTH(handle) ((handle)->currBufferLength - (handle)->currBufferPosition)
+
+//moves the part behind the cursor back to the end of the buffer if TERM_lineGetString pulled it forward
+static void TERM_lineOpenGap(TERMINAL_HANDLE * handle){
+    if(!handle->lineGapClosed) return;
+    
+    uint32_t tailLength = TERM_LINE_TAIL_LENGTH(handle);
+    memmove(&handle->inputBuffer[TERM_INPUTBUFFER_SIZE - 1 - tailLength], &handle->inputBuffer[handle->currBufferPosition], tailLength);
+    handle->inputBuffer[TERM_INPUTBUFFER_SIZE - 1] = 0;
+    handle->lineGapClosed = 0;
+}
+
+void TERM_lineClear(TERMINAL_HANDLE * handle){
+    handle->currBufferPosition = 0;
+    handle->currBufferLength = 0;
+    handle->lineGapClosed = 0;
+    handle->lineShadowValid = 0;
+    handle->inputBuffer[0] = 0;
+    handle->inputBuffer[TERM_INPUTBUFFER_SIZE - 1] = 0;
+}
+
+//inserts data in front of the cursor, returns how many characters actually fit
+uint32_t TERM_lineInsert(TERMINAL_HANDLE * handle, const char * data, uint32_t length){
+    TERM_lineOpenGap(handle);
+    handle->lineShadowValid = 0;
+    
+    uint32_t freeSpace = TERM_INPUTBUFFER_SIZE - 1 - handle->currBufferLength;
+    if(length > freeSpace) length = freeSpace;
+    
+    memcpy(&handle->inputBuffer[handle->currBufferPosition], data, length);
+    handle->currBufferPosition += length;
+    handle->currBufferLength += length;
+    return length;
+}
+
+//removes the character in front of the cursor (backspace)
+unsigned TERM_lineDeleteBack(TERMINAL_HANDLE * handle){
+    if(handle->currBufferPosition == 0) return 0;
+    TERM_lineOpenGap(handle);
+    handle->lineShadowValid = 0;
+    
+    handle->currBufferPosition--;
+    handle->currBufferLength--;
+    return 1;
+}
+
+//removes the character behind the cursor (del)
+unsigned TERM_lineDeleteForward(TERMINAL_HANDLE * handle){
+    if(handle->currBufferPosition == handle->currBufferLength) return 0;
+    TERM_lineOpenGap(handle);
+    handle->lineShadowValid = 0;
+    
+    //the tail is right aligned, so dropping its first character is just a matter of making it shorter
+    handle->currBufferLength--;
+    return 1;
+}
+
+//moves the cursor, only the characters between the old and new position get copied across the gap
+void TERM_lineSetCursor(TERMINAL_HANDLE * handle, uint32_t position){
+    if(position > handle->currBufferLength) position = handle->currBufferLength;
+    if(position == handle->currBufferPosition) return;
+    TERM_lineOpenGap(handle);
+    handle->lineShadowValid = 0;
+    
+    char * tail = &handle->inputBuffer[TERM_INPUTBUFFER_SIZE - 1 - TERM_LINE_TAIL_LENGTH(handle)];
+    if(position < handle->currBufferPosition){
+        uint32_t count = handle->currBufferPosition - position;
+        memmove(tail - count, &handle->inputBuffer[position], count);
+    }else{
+        uint32_t count = position - handle->currBufferPosition;
+        memmove(&handle->inputBuffer[handle->currBufferPosition], tail, count);
+    }
+    handle->currBufferPosition = position;
+}
+
+//returns the (zero terminated) part of the line behind the cursor
+const char * TERM_lineGetTail(TERMINAL_HANDLE * handle){
+    if(handle->lineGapClosed) return &handle->inputBuffer[handle->currBufferPosition];
+    return &handle->inputBuffer[TERM_INPUTBUFFER_SIZE - 1 - TERM_LINE_TAIL_LENGTH(handle)];
+}
+
+//returns the whole line as a zero terminated string starting at inputBuffer. Stays valid until the next edit
+char * TERM_lineGetString(TERMINAL_HANDLE * handle){
+    if(!handle->lineGapClosed){
+        uint32_t tailLength = TERM_LINE_TAIL_LENGTH(handle);
+        if(tailLength != 0){
+            memmove(&handle->inputBuffer[handle->currBufferPosition], &handle->inputBuffer[TERM_INPUTBUFFER_SIZE - 1 - tailLength], tailLength);
+            handle->lineGapClosed = 1;
+        }
+        handle->inputBuffer[handle->currBufferLength] = 0;
+    }
+    return handle->inputBuffer;
+}
+
+//replaces the whole line, the cursor ends up at the end of it
+void TERM_lineSetString(TERMINAL_HANDLE * handle, const char * string){
+    TERM_lineClear(handle);
+    TERM_lineInsert(handle, string, strlen(string));
+    handle->inputBuffer[handle->currBufferLength] = 0;
+}
+
+//writes data into the shadow at *position and remembers where it first differed from what was there before
+static void TERM_lineShadowWrite(TERMINAL_HANDLE * handle, const char * data, uint32_t length, uint32_t * position, uint32_t * firstChange){
+    uint32_t currPos = 0;
+    for(;currPos < length && *position < TERM_INPUTBUFFER_SIZE - 1; currPos++){
+        if(*firstChange == 0xffffffff && (*position >= handle->lineShadowLength || handle->lineShadow[*position] != data[currPos])) *firstChange = *position;
+        handle->lineShadow[(*position)++] = data[currPos];
+    }
+}
+
+//shows prefix (prefixLength chars) followed by text (in quotation marks if quote is set) after the prompt, with the cursor at the end.
+//Only the cursor movement to the first changed character, the changed characters and an erase to the end of line (if the new text is shorter) are sent
+void TERM_lineShow(TERMINAL_HANDLE * handle, const char * prefix, uint32_t prefixLength, const char * text, unsigned quote){
+    //if we aren't showing anything else right now the screen shows the input line
+    if(!handle->lineShadowValid){
+        memcpy(handle->lineShadow, TERM_lineGetString(handle), handle->currBufferLength);
+        handle->lineShadowLength = handle->currBufferLength;
+        handle->lineShadowCursor = handle->currBufferPosition;
+        handle->lineShadowValid = 1;
+    }
+    
+    uint32_t newLength = 0;
+    uint32_t firstChange = 0xffffffff;
+    TERM_lineShadowWrite(handle, prefix, prefixLength, &newLength, &firstChange);
+    if(quote) TERM_lineShadowWrite(handle, "\"", 1, &newLength, &firstChange);
+    TERM_lineShadowWrite(handle, text, strlen(text), &newLength, &firstChange);
+    if(quote) TERM_lineShadowWrite(handle, "\"", 1, &newLength, &firstChange);
+    if(firstChange == 0xffffffff) firstChange = newLength;
+    
+    //move to the first character that changed
+    if(handle->lineShadowCursor > firstChange){
+        TERM_sendVT100Code(handle, _VT100_CURSOR_BACK_BY, handle->lineShadowCursor - firstChange);
+    }else if(handle->lineShadowCursor < firstChange){
+        TERM_sendVT100Code(handle, _VT100_CURSOR_FORWARD_BY, firstChange - handle->lineShadowCursor);
+    }
+    
+    //print everything from there on and get rid of any leftovers from the old text
+    ttwriteEcho(&handle->lineShadow[firstChange], newLength - firstChange);
+    if(newLength < handle->lineShadowLength) TERM_sendVT100Code(handle, _VT100_ERASE_LINE_END, 0);
+    
+    handle->lineShadowLength = newLength;
+    handle->lineShadowCursor = newLength;
+}
+
+//switches back to showing the input line itself, with the cursor where it belongs
+void TERM_lineShowInput(TERMINAL_HANDLE * handle){
+    TERM_lineShow(handle, TERM_lineGetString(handle), handle->currBufferLength, "", 0);
+    if(handle->currBufferPosition != handle->currBufferLength) TERM_sendVT100Code(handle, _VT100_CURSOR_BACK_BY, handle->currBufferLength - handle->currBufferPosition);
+    handle->lineShadowValid = 0;
+}
+
+//prints the whole input line right after a freshly printed prompt
+void TERM_linePrint(TERMINAL_HANDLE * handle){
+    ttwriteEcho(TERM_lineGetString(handle), handle->currBufferLength);
+    if(handle->currBufferPosition != handle->currBufferLength) TERM_sendVT100Code(handle, _VT100_CURSOR_BACK_BY, handle->currBufferLength - handle->currBufferPosition);
+    handle->lineShadowValid = 0;
+}
@@ -0,0 +1,269 @@
+/*
+ * TTerm
+ *
+ * Copyright (c) 2020 Thorben Zethoff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+    
+#if PIC32 == 1
+#include <xc.h>
+#endif  
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <limits.h>
+
+#include "TTerm_printf.h"
+
+#define FLAG_LEFT       0x01
+#define FLAG_ZERO       0x02
+#define FLAG_PLUS       0x04
+#define FLAG_SPACE      0x08
+#define FLAG_UPPER      0x10
+
+typedef struct{
+    TermFormatSink  sink;
+    void *          context;
+    uint32_t        length;
+    uint32_t        total;
+    char            chunk[TERM_FORMAT_CHUNK_SIZE];
+} TermFormatState;
+
+static void TERM_formatFlush(TermFormatState * state){
+    if(state->length == 0) return;
+    (*state->sink)(state->context, state->chunk, state->length);
+    state->length = 0;
+}
+
+static void TERM_formatPutChar(TermFormatState * state, char c){
+    if(state->length == TERM_FORMAT_CHUNK_SIZE) TERM_formatFlush(state);
+    state->chunk[state->length++] = c;
+    state->total++;
+}
+
+static void TERM_formatPutData(TermFormatState * state, const char * data, uint32_t length){
+    if(length >= TERM_FORMAT_CHUNK_SIZE){
+        //wouldn't fit anyway, pass it on as it is
+        TERM_formatFlush(state);
+        (*state->sink)(state->context, data, length);
+        state->total += length;
+        return;
+    }
+    
+    uint32_t currPos = 0;
+    for(;currPos < length; currPos++) TERM_formatPutChar(state, data[currPos]);
+}
+
+static void TERM_formatPad(TermFormatState * state, char c, int32_t count){
+    for(;count > 0; count--) TERM_formatPutChar(state, c);
+}
+
+static void TERM_formatNumber(TermFormatState * state, unsigned long long value, unsigned negative, uint32_t base, uint32_t flags, int32_t width, int32_t precision){
+    const char * digitChars = (flags & FLAG_UPPER) ? "0123456789ABCDEF" : "0123456789abcdef";
+    char digits[sizeof(unsigned long long) * 3];
+    int32_t digitCount = 0;
+    
+    //digits end up in reverse order. Dividing a long long is slow on 32bit targets, so that is only done as long as the value doesn't fit into a long
+    while(value > ULONG_MAX){
+        digits[digitCount++] = digitChars[value % base];
+        value /= base;
+    }
+    unsigned long shortValue = (unsigned long) value;
+    while(shortValue){
+        digits[digitCount++] = digitChars[shortValue % base];
+        shortValue /= base;
+    }
+    
+    //printf prints nothing for a zero with a precision of 0
+    if(digitCount == 0 && precision != 0) digits[digitCount++] = '0';
+    
+    char sign = 0;
+    if(negative) sign = '-';
+    else if(flags & FLAG_PLUS) sign = '+';
+    else if(flags & FLAG_SPACE) sign = ' ';
+    
+    int32_t zeros = (precision > digitCount) ? precision - digitCount : 0;
+    int32_t padding = width - digitCount - zeros - (sign != 0);
+    
+    //the 0 flag only counts if there is no precision
+    if((flags & FLAG_ZERO) && !(flags & FLAG_LEFT) && precision < 0){
+        zeros += padding;
+        padding = 0;
+    }
+    
+    if(!(flags & FLAG_LEFT)) TERM_formatPad(state, ' ', padding);
+    if(sign) TERM_formatPutChar(state, sign);
+    TERM_formatPad(state, '0', zeros);
+    while(digitCount) TERM_formatPutChar(state, digits[--digitCount]);
+    if(flags & FLAG_LEFT) TERM_formatPad(state, ' ', padding);
+}
+
+static void TERM_formatString(TermFormatState * state, const char * str, uint32_t flags, int32_t width, int32_t precision){
+    if(str == NULL) str = "(null)";
+    
+    //don't read any further than the precision allows, the string might not be terminated
+    int32_t length = 0;
+    while((precision < 0 || length < precision) && str[length] != 0) length++;
+    
+    if(!(flags & FLAG_LEFT)) TERM_formatPad(state, ' ', width - length);
+    TERM_formatPutData(state, str, length);
+    if(flags & FLAG_LEFT) TERM_formatPad(state, ' ', width - length);
+}
+
+//formats like vprintf would and hands the output to sink in chunks of at most TERM_FORMAT_CHUNK_SIZE bytes (bigger strings are passed on in one piece). Returns the number of characters printed
+uint32_t TERM_vformat(TermFormatSink sink, void * context, const char * format, va_list arg){
+    TermFormatState state;
+    state.sink = sink;
+    state.context = context;
+    state.length = 0;
+    state.total = 0;
+    
+    while(*format){
+        if(*format != '%'){
+            //copy everything up to the next conversion in one go
+            const char * start = format;
+            while(*format && *format != '%') format++;
+            TERM_formatPutData(&state, start, format - start);
+            continue;
+        }
+        
+        const char * conversionStart = format++;
+        
+        //flags
+        uint32_t flags = 0;
+        for(;;format++){
+            if(*format == '-') flags |= FLAG_LEFT;
+            else if(*format == '0') flags |= FLAG_ZERO;
+            else if(*format == '+') flags |= FLAG_PLUS;
+            else if(*format == ' ') flags |= FLAG_SPACE;
+            else if(*format == '#') continue;
+            else break;
+        }
+        
+        //width
+        int32_t width = 0;
+        if(*format == '*'){
+            width = va_arg(arg, int);
+            if(width < 0){
+                flags |= FLAG_LEFT;
+                width = -width;
+            }
+            format++;
+        }else{
+            while(*format >= '0' && *format <= '9') width = width * 10 + (*format++ - '0');
+        }
+        
+        //precision, -1 if there is none
+        int32_t precision = -1;
+        if(*format == '.'){
+            format++;
+            if(*format == '*'){
+                precision = va_arg(arg, int);
+                if(precision < 0) precision = -1;
+                format++;
+            }else{
+                precision = 0;
+                while(*format >= '0' && *format <= '9') precision = precision * 10 + (*format++ - '0');
+            }
+        }
+        
+        //length modifier, 0 = int, 1 = long, 2 = long long, 3 = size_t
+        uint32_t size = 0;
+        if(*format == 'h'){
+            format++;
+            if(*format == 'h') format++;
+        }else if(*format == 'l'){
+            format++;
+            size = 1;
+            if(*format == 'l'){
+                format++;
+                size = 2;
+            }
+        }else if(*format == 'z'){
+            format++;
+            size = 3;
+        }
+        
+        switch(*format){
+            case 'd':
+            case 'i': {
+                long long value;
+                if(size == 0) value = va_arg(arg, int);
+                else if(size == 1) value = va_arg(arg, long);
+                else if(size == 2) value = va_arg(arg, long long);
+                else value = (long) va_arg(arg, size_t);
+                
+                //negate as unsigned so LLONG_MIN doesn't overflow
+                unsigned long long magnitude = (value < 0) ? 0ULL - (unsigned long long) value : (unsigned long long) value;
+                TERM_formatNumber(&state, magnitude, value < 0, 10, flags, width, precision);
+                break;
+            }
+                
+            case 'u':
+            case 'x':
+            case 'X': {
+                unsigned long long value;
+                if(size == 0) value = va_arg(arg, unsigned);
+                else if(size == 1) value = va_arg(arg, unsigned long);
+                else if(size == 2) value = va_arg(arg, unsigned long long);
+                else value = va_arg(arg, size_t);
+                
+                if(*format == 'X') flags |= FLAG_UPPER;
+                TERM_formatNumber(&state, value, 0, (*format == 'u') ? 10 : 16, flags & ~(FLAG_PLUS | FLAG_SPACE), width, precision);
+                break;
+            }
+                
+            case 'p':
+                TERM_formatPutData(&state, "0x", 2);
+                TERM_formatNumber(&state, (unsigned long) va_arg(arg, void *), 0, 16, 0, 0, -1);
+                break;
+                
+            case 's':
+                TERM_formatString(&state, va_arg(arg, const char *), flags, width, precision);
+                break;
+                
+            case 'c': {
+                char c = (char) va_arg(arg, int);
+                if(!(flags & FLAG_LEFT)) TERM_formatPad(&state, ' ', width - 1);
+                TERM_formatPutChar(&state, c);
+                if(flags & FLAG_LEFT) TERM_formatPad(&state, ' ', width - 1);
+                break;
+            }
+                
+            case '%':
+                TERM_formatPutChar(&state, '%');
+                break;
+                
+            case 0:
+                //format ends in the middle of a conversion, print what we have and stop
+                TERM_formatPutData(&state, conversionStart, format - conversionStart);
+                TERM_formatFlush(&state);
+                return state.total;
+                
+            default:
+                //we don't know that one, print it as it is so at least the missing value is obvious
+                TERM_formatPutData(&state, conversionStart, format - conversionStart + 1);
+                break;
+        }
+        format++;
+    }
+    
+    TERM_formatFlush(&state);
+    return state.total;
+}
@@ -0,0 +1,255 @@
+/*
+ * TTerm
+ *
+ * Copyright (c) 2020 Thorben Zethoff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+    
+#if PIC32 == 1
+#include <xc.h>
+#endif  
+#include <stdint.h>
+#include <string.h>
+
+#include "TTerm.h"
+#include "TTerm_trie.h"
+
+void TERM_trieInit(TermTrie * trie){
+    memset(trie, 0, sizeof(TermTrie));
+}
+
+void TERM_trieFree(TermTrie * trie){
+    TermTrieBlock * currBlock = trie->blocks;
+    while(currBlock != NULL){
+        TermTrieBlock * next = currBlock->next;
+        TERM_FREE(currBlock);
+        currBlock = next;
+    }
+    TERM_trieInit(trie);
+}
+
+//makes sure count nodes can be taken without an allocation failing halfway through an insert
+static unsigned TERM_trieReserve(TermTrie * trie, uint32_t count){
+    uint32_t available = trie->freeCount;
+    if(trie->blocks != NULL) available += TERM_TRIE_BLOCK_SIZE - trie->blocks->used;
+    if(available >= count) return 1;
+    
+    TermTrieBlock * block = TERM_MALLOC(sizeof(TermTrieBlock));
+    if(block == NULL) return 0;
+    
+    //whatever is left in the old block is lost, but there's never more than one node of it
+    block->used = 0;
+    block->next = trie->blocks;
+    trie->blocks = block;
+    return 1;
+}
+
+static TermTrieNode * TERM_trieNewNode(TermTrie * trie){
+    TermTrieNode * node;
+    if(trie->freeNodes != NULL){
+        node = trie->freeNodes;
+        trie->freeNodes = node->next;
+        trie->freeCount--;
+    }else{
+        node = &trie->blocks->nodes[trie->blocks->used++];
+    }
+    memset(node, 0, sizeof(TermTrieNode));
+    return node;
+}
+
+//returns the link pointing to the child of node starting with c, or to where it would have to be inserted
+static TermTrieNode ** TERM_trieFindChild(const TermTrieNode * node, char c){
+    TermTrieNode ** link = (TermTrieNode **) &node->child;
+    while(*link != NULL && (uint8_t) (*link)->label[0] < (uint8_t) c) link = &(*link)->next;
+    return link;
+}
+
+static const TermTrieNode * TERM_trieFindKey(const TermTrie * trie, const char * key, uint32_t length){
+    uint32_t depth;
+    const TermTrieNode * node = TERM_trieFindPrefix(trie, key, length, &depth);
+    return (node != NULL && depth == length && node->key != NULL) ? node : NULL;
+}
+
+//adds key to the trie, returns 0 if there wasn't enough memory. A key that is in there already is left as it is
+unsigned TERM_trieInsert(TermTrie * trie, const char * key, uint32_t length){
+    if(TERM_trieFindKey(trie, key, length) != NULL) return 1;
+    
+    //worst case is one split and one new leaf
+    if(!TERM_trieReserve(trie, 2)) return 0;
+    
+    TermTrieNode * node = &trie->root;
+    uint32_t pos = 0;
+    node->keyCount++;
+    
+    while(pos < length){
+        TermTrieNode ** link = TERM_trieFindChild(node, key[pos]);
+        TermTrieNode * child = *link;
+        
+        if(child == NULL || child->label[0] != key[pos]){
+            //nothing shares the rest of the key, add it as a new leaf
+            TermTrieNode * leaf = TERM_trieNewNode(trie);
+            leaf->label = &key[pos];
+            leaf->labelLength = length - pos;
+            leaf->key = key;
+            leaf->keyCount = 1;
+            leaf->next = child;
+            *link = leaf;
+            return 1;
+        }
+        
+        uint32_t common = 1;
+        while(common < child->labelLength && pos + common < length && child->label[common] == key[pos + common]) common++;
+        
+        if(common < child->labelLength){
+            //the key leaves the label halfway through, split the node
+            TermTrieNode * split = TERM_trieNewNode(trie);
+            split->label = child->label;
+            split->labelLength = common;
+            split->keyCount = child->keyCount;
+            split->child = child;
+            split->next = child->next;
+            *link = split;
+            
+            child->label += common;
+            child->labelLength -= common;
+            child->next = NULL;
+            child = split;
+        }
+        
+        child->keyCount++;
+        node = child;
+        pos += common;
+    }
+    
+    node->key = key;
+    return 1;
+}
+
+//first key below node (in this node if it has one)
+static const char * TERM_trieAnyKey(const TermTrieNode * node){
+    while(node->key == NULL) node = node->child;
+    return node->key;
+}
+
+//a branch that held only one key is a single chain of nodes
+static void TERM_trieFreeBranch(TermTrie * trie, TermTrieNode * node){
+    while(node != NULL){
+        TermTrieNode * child = node->child;
+        node->next = trie->freeNodes;
+        trie->freeNodes = node;
+        trie->freeCount++;
+        node = child;
+    }
+}
+
+void TERM_trieRemove(TermTrie * trie, const char * key, uint32_t length){
+    TermTrieNode * target = (TermTrieNode *) TERM_trieFindKey(trie, key, length);
+    if(target == NULL) return;
+    target->key = NULL;
+    
+    //drop the key from the counts on its path and give back the part that only held it
+    TermTrieNode * node = &trie->root;
+    uint32_t pos = 0;
+    node->keyCount--;
+    while(pos < length){
+        TermTrieNode ** link = TERM_trieFindChild(node, key[pos]);
+        TermTrieNode * child = *link;
+        if(--child->keyCount == 0){
+            *link = child->next;
+            TERM_trieFreeBranch(trie, child);
+            break;
+        }
+        pos += child->labelLength;
+        node = child;
+    }
+    
+    //labels on the path might still point into the removed key (which could get freed afterwards), point them into one that stays
+    node = &trie->root;
+    pos = 0;
+    while(pos < length){
+        TermTrieNode * child = *TERM_trieFindChild(node, key[pos]);
+        if(child == NULL || child->label[0] != key[pos]) break;
+        child->label = TERM_trieAnyKey(child) + pos;
+        pos += child->labelLength;
+        node = child;
+    }
+}
+
+//walks down from node, which the first pos characters of prefix lead to
+static const TermTrieNode * TERM_trieDescend(const TermTrieNode * node, uint32_t pos, const char * prefix, uint32_t length, uint32_t * depth){
+    while(pos < length){
+        const TermTrieNode * child = *TERM_trieFindChild(node, prefix[pos]);
+        if(child == NULL || child->label[0] != prefix[pos]) return NULL;
+        
+        uint32_t compareLength = child->labelLength;
+        if(compareLength > length - pos) compareLength = length - pos;
+        if(memcmp(child->label, &prefix[pos], compareLength) != 0) return NULL;
+        
+        pos += child->labelLength;
+        node = child;
+    }
+    
+    if(node->keyCount == 0) return NULL;
+    if(depth != NULL) *depth = pos;
+    return node;
+}
+
+//returns the node all keys starting with prefix are in (or NULL if there are none). depth is set to the length of the keys up to the end of that node
+const TermTrieNode * TERM_trieFindPrefix(const TermTrie * trie, const char * prefix, uint32_t length, uint32_t * depth){
+    return TERM_trieDescend(&trie->root, 0, prefix, length, depth);
+}
+
+//same as TERM_trieFindPrefix for a prefix that got longer since node and depth were found for it. Only the new part is looked at
+const TermTrieNode * TERM_trieNarrow(const TermTrieNode * node, const char * prefix, uint32_t length, uint32_t * depth){
+    //the old prefix might have ended halfway through the label of node
+    uint32_t labelStart = *depth - node->labelLength;
+    if(length > labelStart && node->labelLength != 0){
+        uint32_t compareLength = (length < *depth) ? length - labelStart : node->labelLength;
+        if(memcmp(node->label, &prefix[labelStart], compareLength) != 0) return NULL;
+    }
+    return TERM_trieDescend(node, *depth, prefix, length, depth);
+}
+
+//index-th key below node in sorted order, keyCount lets us skip whole subtrees
+const char * TERM_trieGetKey(const TermTrieNode * node, uint32_t index){
+    if(index >= node->keyCount) return NULL;
+    
+    while(1){
+        if(node->key != NULL){
+            if(index == 0) return node->key;
+            index--;
+        }
+        
+        node = node->child;
+        while(index >= node->keyCount){
+            index -= node->keyCount;
+            node = node->next;
+        }
+    }
+}
+
+//length of the longest prefix shared by all keys below node. example is set to one of them so the caller can copy the prefix out of it
+uint32_t TERM_trieCommonPrefix(const TermTrieNode * node, uint32_t depth, const char ** example){
+    while(node->key == NULL && node->child != NULL && node->child->next == NULL){
+        node = node->child;
+        depth += node->labelLength;
+    }
+    if(example != NULL) *example = TERM_trieAnyKey(node);
+    return depth;
+}
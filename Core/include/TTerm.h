@@ -27,6 +27,7 @@
 #define TERM_VERSION_STRING "V1.0"
 
 #include <stdint.h>
+#include <stdarg.h>
 
 //include freeRTOS if available
 #if !__is_compiling || __has_include("FreeRTOS.h")
@@ -34,9 +35,11 @@
 #include "task.h"
 #include "queue.h"
 #include "stream_buffer.h"
+#include "semphr.h"
 #endif
 
 #include "TTerm_VT100.h"
+#include "TTerm_trie.h"
 #include "TTerm_config.h"
 
 #ifdef TERM_ENABLE_CWD
@@ -48,6 +51,8 @@
 #define CTRL_D 							0x04
 
 #define TERM_ARGS_ERROR_STRING_LITERAL 	0xffff
+#define TERM_ARGS_ERROR_ESCAPE 			0xfffe
+#define TERM_ARGS_ERROR_TOO_MANY 		0xfffd
 
 #define TERM_CMD_EXIT_ERROR 			0
 #define TERM_CMD_EXIT_NOT_FOUND 		1
@@ -61,9 +66,13 @@
 	#define TERM_DEFAULT_STACKSIZE 		0
 #endif
 
+//commands registered with this stack size don't get a task, the terminal runs them itself. They must not wait for anything
+#define TERM_INLINE_STACKSIZE 			0xffffffff
+
 //Terminal struct defines
 typedef struct __TERMINAL_HANDLE__ TERMINAL_HANDLE;
 typedef struct __TermCommandDescriptor__ TermCommandDescriptor;
+typedef struct __TermCommandIndex__ TermCommandIndex;
 
 
 //Function prototypes
@@ -78,21 +87,183 @@ extern TermCommandDescriptor TERM_defaultList;
 //CWD Defines
 #if TERM_SUPPORT_CWD == 1
     #define TERM_DEVICE_NAME handle->cwdPath
+    
+    //number of directory listings the path completer keeps around
+    #ifndef TERM_CWD_CACHE_SIZE
+        #define TERM_CWD_CACHE_SIZE 4
+    #endif
 #else
     #define TERM_DEVICE_NAME TERM_NAME
 #endif
 
 //defines for optional Handle extension on printf
+//NOTE: while the output of a terminal is buffered (see TERM_startOutputBuffering) prints from the task holding the buffer are collected and sent with the next flush
+//raw data for the write handler, one entry per contiguous piece of data
+typedef struct{
+    const void * data;
+    uint32_t length;
+} TermIovec;
+
+#ifndef TERM_BUILTIN_PRINTF
+	#define TERM_BUILTIN_PRINTF 0
+#endif
+
 #if EXTENDED_PRINTF == 1
-	#define ttprintfEcho(format, ...) if(handle->currEchoEnabled) (*handle->print)(handle->port, format, ##__VA_ARGS__)
-	#define ttprintf(format, ...) (*handle->print)(handle->port, format, ##__VA_ARGS__)
+	#define ttprintfEcho(format, ...) if(handle->currEchoEnabled) ttprintf(format, ##__VA_ARGS__)
+	#if TERM_BUILTIN_PRINTF == 1
+		#define ttprintf(format, ...) TERM_printf(handle, format, ##__VA_ARGS__)
+	#else
+		#define ttprintf(format, ...) (TERM_isOutputBuffered(handle) ? TERM_bufferedPrint(handle, format, ##__VA_ARGS__) : (*handle->print)(handle->port, format, ##__VA_ARGS__))
+	#endif
 	typedef uint32_t (* TermPrintHandler)(void * port, char * format, ...);
+	typedef void (* TermWriteHandler)(void * port, const TermIovec * data, uint32_t count);
 
 #else
-	#define ttprintfEcho(format, ...) if(echoEnabled) (*handle->print)(format, ##__VA_ARGS__)
-	#define ttprintf(format, ...) (*handle->print)(format, ##__VA_ARGS__)
+	#define ttprintfEcho(format, ...) if(handle->currEchoEnabled) ttprintf(format, ##__VA_ARGS__)
+	#if TERM_BUILTIN_PRINTF == 1
+		#define ttprintf(format, ...) ((void) TERM_printf(handle, format, ##__VA_ARGS__))
+	#else
+		#define ttprintf(format, ...) (TERM_isOutputBuffered(handle) ? (void) TERM_bufferedPrint(handle, format, ##__VA_ARGS__) : (*handle->print)(format, ##__VA_ARGS__))
+	#endif
 	typedef void (* TermPrintHandler)(char * format, ...);
+	typedef void (* TermWriteHandler)(const TermIovec * data, uint32_t count);
+
+#endif
+
+//raw output without any formatting. Goes to the write handler of the port if it has one (or through print with "%.*s" otherwise)
+#define ttwrite(data, length) TERM_write(handle, data, length)
+#define ttwriteEcho(data, length) if(handle->currEchoEnabled) ttwrite(data, length)
+//only for string literals! Length is determined at compile time
+#define ttwriteLiteral(str) ttwrite(str, sizeof(str) - 1)
+#define ttwriteLiteralEcho(str) ttwriteEcho(str, sizeof(str) - 1)
+
+#ifndef TERM_OUTPUTBUFFER_SIZE
+	#define TERM_OUTPUTBUFFER_SIZE 256
+#endif
 
+#ifndef TERM_DEFAULT_ROWS
+	#define TERM_DEFAULT_ROWS 24
+#endif
+
+#ifndef TERM_DEFAULT_COLUMNS
+	#define TERM_DEFAULT_COLUMNS 80
+#endif
+
+//number of pooled command tasks per stack size class, see TTerm_config.h
+#ifndef TERM_WORKERS_PER_CLASS
+	#define TERM_WORKERS_PER_CLASS 2
+#endif
+
+//give every terminal a task that handles its input and program messages, see TTerm_config.h
+#ifndef TERM_SERVICE_TASK
+	#define TERM_SERVICE_TASK 0
+#endif
+
+#ifndef TERM_SERVICE_STACK_SIZE
+	#define TERM_SERVICE_STACK_SIZE (configMINIMAL_STACK_SIZE + 300)
+#endif
+
+#ifndef TERM_SERVICE_PRIORITY
+	#define TERM_SERVICE_PRIORITY (tskIDLE_PRIORITY + 1)
+#endif
+
+#ifndef TERM_FEED_BUFFER_SIZE
+	#define TERM_FEED_BUFFER_SIZE 64
+#endif
+
+#if TERM_SERVICE_TASK == 1 && !defined TERM_startTaskPerCommand
+	#error TERM_SERVICE_TASK needs TERM_startTaskPerCommand
+#endif
+
+//number of background jobs per terminal, 0 disables job control. See TTerm_config.h
+#ifndef TERM_MAX_JOBS
+	#define TERM_MAX_JOBS 0
+#endif
+
+#ifndef TERM_JOB_OUTPUT_SIZE
+	#define TERM_JOB_OUTPUT_SIZE 256
+#endif
+
+//key that stops the program in the foreground, 0 to hand it to the program like any other
+#ifndef TERM_JOB_STOP_KEY
+	#define TERM_JOB_STOP_KEY 0x1a
+#endif
+
+#if TERM_MAX_JOBS > 0 && !defined TERM_startTaskPerCommand
+	#error TERM_MAX_JOBS needs TERM_startTaskPerCommand
+#endif
+
+//stack usage statistics per command and sizing stacks after them, see TTerm_config.h
+#ifndef TERM_CMD_STATS
+	#define TERM_CMD_STATS 0
+#endif
+
+#ifndef TERM_CMD_STATS_SIZE
+	#define TERM_CMD_STATS_SIZE 32
+#endif
+
+#ifndef TERM_STACK_TUNING
+	#define TERM_STACK_TUNING 0
+#endif
+
+#ifndef TERM_STACK_TUNING_MARGIN
+	#define TERM_STACK_TUNING_MARGIN 100
+#endif
+
+#if TERM_CMD_STATS == 1 && !defined TERM_startTaskPerCommand
+	#error TERM_CMD_STATS needs TERM_startTaskPerCommand
+#endif
+
+#if TERM_STACK_TUNING == 1 && TERM_CMD_STATS != 1
+	#error TERM_STACK_TUNING needs TERM_CMD_STATS
+#endif
+
+//run commands without any heap use, see TTerm_config.h
+#ifndef TERM_STATIC_ALLOCATION
+	#define TERM_STATIC_ALLOCATION 0
+#endif
+
+#if TERM_STATIC_ALLOCATION == 1 && defined TERM_startTaskPerCommand && (!defined TERM_WORKER_STACK_CLASSES || !defined TERM_WORKER_STACK_WORDS)
+	#error TERM_STATIC_ALLOCATION runs all commands on the worker pool, it needs TERM_WORKER_STACK_CLASSES and TERM_WORKER_STACK_WORDS
+#endif
+
+//most arguments a command can be called with, commands get the count as an uint8_t so this can't be more than 255
+#ifndef TERM_MAX_ARGS
+	#define TERM_MAX_ARGS 32
+#endif
+
+//put commands registered with TERM_STATIC_COMMAND into flash? This needs the linker script to include TTerm_commands.ld
+#ifndef TERM_STATIC_COMMANDS
+	#define TERM_STATIC_COMMANDS 0
+#endif
+
+//look static commands up with a perfect hash table generated by tools/tterm_phash.py (TTerm_phash.h) instead of a binary search. Requires TERM_STATIC_COMMANDS
+#ifndef TERM_PERFECT_HASH
+	#define TERM_PERFECT_HASH 0
+#endif
+
+//number of buckets the command hash index starts with. It doubles whenever there are more commands than buckets
+#ifndef TERM_CMD_HASH_INITIAL_SIZE
+	#define TERM_CMD_HASH_INITIAL_SIZE 16
+#endif
+
+//number of strings a non const autocomplete list has room for at first. It doubles whenever it is full
+#ifndef ACL_INITIAL_SIZE
+	#define ACL_INITIAL_SIZE 8
+#endif
+
+//subsequence matching for completion if there's no prefix match, see TTerm_config.h
+#ifndef TERM_FUZZY_COMPLETION
+	#define TERM_FUZZY_COMPLETION 0
+#endif
+
+#ifndef TERM_FUZZY_MAX_CANDIDATES
+	#define TERM_FUZZY_MAX_CANDIDATES 8
+#endif
+
+//a second tab lists all candidates instead of cycling through them, see TTerm_config.h
+#ifndef TERM_TAB_LIST_CANDIDATES
+	#define TERM_TAB_LIST_CANDIDATES 1
 #endif
 
 
@@ -111,7 +282,14 @@ extern TermCommandDescriptor TERM_defaultList;
 		//function abbreviations
 		#define ttgetline(X) TERM_getLine(handle, X, TERM_CONTROL_IGNORE)
 		#define ttgetlineSpecial(X, Y) TERM_getLine(handle, portMAX_DELAY, Y)
+		//gives back a line from TERM_getLine. With TERM_STATIC_ALLOCATION the line is in a buffer of the worker that stays valid until its next TERM_getLine call
+#if TERM_STATIC_ALLOCATION == 1
+		#define TERM_freeLine(X)
+#else
+		#define TERM_freeLine(X) TERM_FREE(X)
+#endif
 		#define ttgetc(X) TERM_getChar(handle, X)
+		#define ttgetcs(BUFF, MAX, X) TERM_getChars(handle, BUFF, MAX, X)
 
 		//enums
 		typedef enum {PROG_RETURN, PROG_SETINPUTMODE, PROG_ENTERFOREGROUND, PROG_EXITFOREGROUND, PROG_KILL} ProgCMDType_t;
@@ -129,6 +307,14 @@ extern TermCommandDescriptor TERM_defaultList;
 			char 				  	* commandString;
 			char 				  	** args;
 			uint8_t argCount;
+			uint32_t 				stackSize;				//what its task was created with
+
+			//programs run by a worker from the pool (see TERM_WORKER_STACK_CLASSES) are kept around for the next command
+			uint32_t 				workerStackSize;		//0 if the program has a task of its own
+			unsigned 				workerBusy;
+#if TERM_STATIC_ALLOCATION == 1
+			char 				  	* lineBuffer;			//TERM_getLine returns this instead of allocating the line
+#endif
 		} TermProgram;
 
 		typedef struct{
@@ -137,6 +323,22 @@ extern TermCommandDescriptor TERM_defaultList;
 			TermProgram 		  	* src;
 			void 				  	* data;
 		} Term_progCMD_t;
+
+		typedef enum {JOB_FREE, JOB_RUNNING, JOB_STOPPED, JOB_DONE} TermJobState_t;
+
+		//a program started with a trailing '&' or stopped with TERM_JOB_STOP_KEY. Everything it prints while it isn't in the foreground is kept in output, the oldest data is dropped once that is full.
+		//One that finishes in the background is JOB_DONE until the terminal is free to report it
+		typedef struct{
+			TermProgram 		  	* program;
+			TermJobState_t 			state;
+			uint8_t 				returnCode;
+			unsigned 				foreground;
+			InputMode_t 			inputMode;			//what the program asked for last, applied once it is in the foreground again
+			uint32_t 				outputStart;
+			uint32_t 				outputLength;
+			uint32_t 				outputDropped;
+			char 					output[TERM_JOB_OUTPUT_SIZE];
+		} TermJob;
         
 	#else
 		//TERM_startTaskPerCommand is set but freeRTOS is not available, throw an error so the user knows whats happening
@@ -144,6 +346,18 @@ extern TermCommandDescriptor TERM_defaultList;
 	#endif
 #endif
 
+//everything a list head needs to find its commands quickly. Only the head points to one, so commands don't carry any of it
+struct __TermCommandIndex__{
+	TermCommandDescriptor ** hashTable;				//allocated with the first command
+	uint32_t 				hashTableSize;
+	unsigned 				unsorted;				//commands were added since the list was last sorted, see TERM_sortCommandList
+	TermTrie			  * trie;					//prefix index over all names for completion, built the first time it is needed (see TERM_getCommandTrie)
+
+	//sorted table of const commands underneath the list (TERM_defaultList gets the ones from TERM_STATIC_COMMAND), commands in the list take precedence over them
+	const TermCommandDescriptor * staticCommands;
+	const TermCommandDescriptor * staticCommandsEnd;
+};
+
 struct __TermCommandDescriptor__{
 	TermCommandFunction function;
 	const char 			  * command;
@@ -154,8 +368,44 @@ struct __TermCommandDescriptor__{
 	void 			 	  * ACParams;
 
 	TermCommandDescriptor * nextCmd;
+	TermCommandDescriptor * nextHash;				//next command in the same bucket of the hash index
+
+	TermCommandIndex 	  * index;					//only used by list heads, commandLength is the number of commands in the list then
 };
 
+//goes through the commands of a list and its static table in alphabetical order
+typedef struct{
+	const TermCommandDescriptor * nextStatic;
+	const TermCommandDescriptor * staticEnd;
+	const TermCommandDescriptor * nextCmd;
+	uint32_t 				remaining;
+} TermCommandIterator;
+
+//how much stack a command needed so far (see TERM_CMD_STATS), all sizes in words like the ones given to xTaskCreate
+typedef struct{
+	const char 			  * command;				//NULL if the entry is free
+	uint32_t 				hash;
+	uint32_t 				runs;
+	uint32_t 				stackSize;				//what it got the last time
+	uint32_t 				lastUsed;				//what it used the last time it ran on a task of its own
+	uint32_t 				peak;					//most it ever used
+} TermCommandStats;
+
+#if TERM_STATIC_COMMANDS == 1
+//commands known at compile time. The descriptor is put into flash in its own .tterm_cmd.{name} section and the linker sorts them into one table (see TTerm_commands.ld), so they cost no heap and no sorting at startup
+//name must be a string literal (or a define of one). The alignment is pinned so the compiler cant pad the entries of the table apart
+#define TERM_STATIC_COMMAND(name, function, description, stackSize) TERM_STATIC_COMMAND_AC(name, function, description, stackSize, 0, 0)
+#define TERM_STATIC_COMMAND_AC(name, handler, description, stack, ACH, ACP) \
+	static const TermCommandDescriptor TERM_STATIC_COMMAND_ID(__LINE__) __attribute__((used, aligned(__alignof__(TermCommandDescriptor)), section(".tterm_cmd." name))) = { \
+		.function = handler, .command = name, .commandDescription = description, .commandLength = sizeof(name) - 1, .stackSize = stack, .ACHandler = ACH, .ACParams = (void *) (ACP) }
+#define TERM_STATIC_COMMAND_ID(line) TERM_STATIC_COMMAND_ID_(line)
+#define TERM_STATIC_COMMAND_ID_(line) TERM_staticCommand_##line
+
+//table bounds, defined by the linker
+extern const TermCommandDescriptor __tterm_cmd_start[];
+extern const TermCommandDescriptor __tterm_cmd_end[];
+#endif
+
 struct __TERMINAL_HANDLE__{
 
 	//autocomplete stuff
@@ -163,36 +413,89 @@ struct __TERMINAL_HANDLE__{
     char 		** 	autocompleteBuffer;
     uint32_t 		autocompleteBufferLength;
     uint32_t 		autocompleteStart;
+    unsigned 		autocompleteActive;
+    unsigned 		autocompleteListPending;	//last key was a tab that didn't finish the word, the next one lists the candidates
+    //instead of allocating autocompleteBuffer a completer can point to the candidates directly: all keys below a trie node or a slice of a sorted string array
+    const TermTrieNode * autocompleteNode;
+    uint32_t 		autocompleteNodeDepth;
+    const char * const * autocompleteSlice;
+    //what the candidates were found for, so typing more only needs to narrow them down (see TERM_doAutoComplete)
+    uint32_t 		autocompleteLineLength;		//0 if they can't be narrowed
+    char 		* 	autocompleteLine;			//copy of the first autocompleteLineLength characters of the line, TERM_INPUTBUFFER_SIZE big
+    const uint32_t * autocompleteVersion;		//changes whenever the list the candidates point into is changed
+    uint32_t 		autocompleteVersionValue;
+#if TERM_FUZZY_COMPLETION == 1
+    const char * 	autocompleteRanked[TERM_FUZZY_MAX_CANDIDATES];		//best fuzzy matches, autocompleteSlice points here if there are any
+#endif
 
     //buffers
     char 		* 	inputBuffer;
+#if TERM_STATIC_ALLOCATION == 1
+    char 			historyBuffer[TERM_HISTORYSIZE][TERM_INPUTBUFFER_SIZE];		//unused entries are empty strings
+#else
     char 		* 	historyBuffer[TERM_HISTORYSIZE];
-    uint8_t 		escSeqBuff[16];
+#endif
 
     //position pointers
     uint32_t 		currBufferPosition;
     uint32_t 		currBufferLength;
     uint32_t 		currHistoryWritePosition;
     uint32_t 		currHistoryReadPosition;
-    uint8_t 		currEscSeqPos;
+    unsigned 		lineGapClosed;
+
+    //copy of what is shown after the prompt while it isn't the input line itself (history entries, completions)
+    char 		* 	lineShadow;
+    uint32_t 		lineShadowLength;
+    uint32_t 		lineShadowCursor;
+    unsigned 		lineShadowValid;
+
+    //escape sequence decoder state
+    TermVT100Decoder vt100Decoder;
+    unsigned 		pasteActive;
+
+    //terminal size, as reported by the terminal after TERM_probeSize
+    uint16_t 		termRows;
+    uint16_t 		termColumns;
 
     //enable flags
     unsigned 		echoEnabled;
     unsigned 		currEchoEnabled;
 
+    //output buffer
+    char 		* 	outputBuffer;
+    uint32_t 		outputBufferLength;
+    uint32_t 		outputBufferDepth;
+#if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
+    TaskHandle_t 	outputBufferOwner;
+#endif
+
     //constants
     char 		* 	currUserName;
     TermCommandDescriptor * cmdListHead;
     TermPrintHandler print;
+    TermWriteHandler write;
     TermErrorPrinter errorPrinter;
 
 #if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
     TermProgram * nextProgram;
     TermProgram * currProgram;
 
-    InputMode_t * currProgramInputMode;
+    InputMode_t currProgramInputMode;
 
     QueueHandle_t cmdStream;
+
+#if TERM_MAX_JOBS > 0
+    //job n is jobs[n - 1]
+    TermJob jobs[TERM_MAX_JOBS];
+#endif
+
+#if TERM_SERVICE_TASK == 1
+    //the service task waits on eventSet for input (from TERM_feedInput, signalled through feedSignal) and cmdStream at once
+    StreamBufferHandle_t feedStream;
+    SemaphoreHandle_t feedSignal;
+    QueueSetHandle_t eventSet;
+    TaskHandle_t serviceTask;
+#endif
 #endif
     
 #if EXTENDED_PRINTF == 1
@@ -201,6 +504,7 @@ struct __TERMINAL_HANDLE__{
     
 #if TERM_SUPPORT_CWD == 1
     char * cwdPath;
+    void * cwdListing;		//cached directory listing the path completer found the candidates in, kept until its next call (see CWD_releaseListing)
 #endif
 };
 
@@ -209,9 +513,9 @@ typedef enum{TERM_CHECK_COMP_AND_HIST = 0b11, TERM_CHECK_COMP = 0b01, TERM_CHECK
 
 //(De-) initializers
 #if EXTENDED_PRINTF == 1
-TERMINAL_HANDLE * TERM_createNewHandle(TermPrintHandler printFunction, void * port, unsigned echoEnabled, TermCommandDescriptor * cmdListHead, TermErrorPrinter errorPrinter, const char * usr);
+TERMINAL_HANDLE * TERM_createNewHandle(TermPrintHandler printFunction, TermWriteHandler writeFunction, void * port, unsigned echoEnabled, TermCommandDescriptor * cmdListHead, TermErrorPrinter errorPrinter, const char * usr);
 #else
-TERMINAL_HANDLE * TERM_createNewHandle(TermPrintHandler printFunction, unsigned echoEnabled, TermCommandDescriptor * cmdListHead, TermErrorPrinter errorPrinter, const char * usr);    
+TERMINAL_HANDLE * TERM_createNewHandle(TermPrintHandler printFunction, TermWriteHandler writeFunction, unsigned echoEnabled, TermCommandDescriptor * cmdListHead, TermErrorPrinter errorPrinter, const char * usr);    
 #endif    
 
 void TERM_destroyHandle(TERMINAL_HANDLE * handle);
@@ -225,9 +529,20 @@ char 		* 	strnchr(char * str, char c, uint32_t length);
 //other utilities
 void 			TERM_setCursorPos(TERMINAL_HANDLE * handle, uint16_t x, uint16_t y);
 
-//VT100 Support TODO improve this?
-void 			TERM_sendVT100Code(TERMINAL_HANDLE * handle, uint16_t cmd, uint8_t var);
-const char 	* 	TERM_getVT100Code(uint16_t cmd, uint8_t var);
+//VT100 Support (TERM_getVT100Code is in TTerm_VT100.h)
+void 			TERM_sendVT100Code(TERMINAL_HANDLE * handle, uint16_t cmd, uint16_t var);
+
+//Output buffering
+void 			TERM_startOutputBuffering(TERMINAL_HANDLE * handle);
+void 			TERM_stopOutputBuffering(TERMINAL_HANDLE * handle);
+void 			TERM_flushOutput(TERMINAL_HANDLE * handle);
+unsigned 		TERM_isOutputBuffered(TERMINAL_HANDLE * handle);
+uint32_t 		TERM_bufferedPrint(TERMINAL_HANDLE * handle, char * format, ...);
+
+//Raw output
+void 			TERM_write(TERMINAL_HANDLE * handle, const char * data, uint32_t length);
+void 			TERM_writev(TERMINAL_HANDLE * handle, const TermIovec * data, uint32_t count);
+void 			TERM_printPrompt(TERMINAL_HANDLE * handle, const char * lineBreak);
 
 //Input processing
 uint8_t 		TERM_processBuffer(uint8_t * data, uint16_t length, TERMINAL_HANDLE * handle);
@@ -238,26 +553,41 @@ TermCommandDescriptor * TERM_addCommand(TermCommandFunction function, const char
 void 			TERM_LIST_add(TermCommandDescriptor * item, TermCommandDescriptor * head); //TODO refactor this to align with naming convention
 void 			TERM_addCommandAC(TermCommandDescriptor * cmd, TermAutoCompHandler ACH, void * ACParams);
 unsigned 		TERM_isSorted(TermCommandDescriptor * a, TermCommandDescriptor * b);
+void 			TERM_sortCommandList(TermCommandDescriptor * head);
+uint32_t 		TERM_getCommandCount(TermCommandDescriptor * head);
+void 			TERM_initCommandIterator(TermCommandIterator * iterator, TermCommandDescriptor * head);
+const TermCommandDescriptor * TERM_nextCommand(TermCommandIterator * iterator);
 void 			TERM_freeCommandList(TermCommandDescriptor ** cl, uint16_t length);
 uint8_t 		TERM_buildCMDList();
 
 //command interpreter
-uint16_t 		TERM_countArgs(const char * data, uint16_t dataLength);
 TermCommandDescriptor * TERM_findCMD(TERMINAL_HANDLE * handle);
+uint32_t 		TERM_hashCommand(const char * name, uint32_t length);
 TermCommandDescriptor * TERM_findCMDFromName(TermCommandDescriptor * list, char * name, uint32_t length);
 uint8_t 		TERM_interpretCMD(char * data, uint16_t dataLength, TERMINAL_HANDLE * handle);
-uint8_t 		TERM_seperateArgs(char * data, uint16_t dataLength, char ** buff);
+uint16_t 		TERM_tokenizeArgs(const char * data, uint16_t dataLength, char * strings, char ** args, uint16_t maxArgs, uint16_t * errorPosition);
 uint8_t 		TERM_findLastArg(TERMINAL_HANDLE * handle, char * buff, uint8_t * lenBuff);
 
 //autocomplete handlers
-uint8_t TERM_findMatchingCMDs(char * currInput, uint8_t length, char ** buff, TermCommandDescriptor * cmdListHead);
+uint32_t TERM_findMatchingCMDs(char * currInput, uint8_t length, char ** buff, TermCommandDescriptor * cmdListHead);
 uint8_t TERM_doAutoComplete(TERMINAL_HANDLE * handle);
+const char * TERM_getCompletion(TERMINAL_HANDLE * handle, uint32_t index);
+uint32_t TERM_getCompletionCommonPrefix(TERMINAL_HANDLE * handle, const char ** example);
+unsigned TERM_completeCommonPrefix(TERMINAL_HANDLE * handle);
+void TERM_listCompletions(TERMINAL_HANDLE * handle);
+uint32_t TERM_completeFuzzy(TERMINAL_HANDLE * handle, char * const * strings, uint32_t count, const char * currInput, uint32_t length);
+void TERM_endCompletion(TERMINAL_HANDLE * handle);
+void TERM_clearCompletion(TERMINAL_HANDLE * handle);
+const TermTrie * TERM_getCommandTrie(TermCommandDescriptor * head);
 
 
 //default printer functions
 void 			TERM_printBootMessage(TERMINAL_HANDLE * handle);
+void 			TERM_probeSize(TERMINAL_HANDLE * handle);
 uint8_t 		TERM_defaultErrorPrinter(TERMINAL_HANDLE * handle, uint32_t retCode);
 void 			TERM_printDebug(TERMINAL_HANDLE * handle, char * format, ...);
+uint32_t 		TERM_printf(TERMINAL_HANDLE * handle, const char * format, ...);
+uint32_t 		TERM_vprintf(TERMINAL_HANDLE * handle, const char * format, va_list arg);
 
 //Programm functions TODO evaluate usage and remove. Perhaps still required without taskPerCommand?
 #if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
@@ -266,8 +596,29 @@ void 			TERM_attachProgramm(TERMINAL_HANDLE * handle, TermProgram * prog);
 void 			TERM_killProgramm(TERMINAL_HANDLE * handle);
 char        *   TERM_getCommandString();
 uint16_t        TERM_getChar(TERMINAL_HANDLE * handle, uint32_t timeout);
+uint32_t        TERM_getChars(TERMINAL_HANDLE * handle, uint16_t * buffer, uint32_t maxCount, uint32_t timeout);
 char        *   TERM_getLine(TERMINAL_HANDLE * handle, uint32_t timeout, uint32_t controlBehaviour);
 #endif
 
+#if TERM_MAX_JOBS > 0 && (!__is_compiling || __has_include("FreeRTOS.h"))
+TermJob 	* 	TERM_getJob(TERMINAL_HANDLE * handle, uint32_t number);
+TermJob 	* 	TERM_getLatestJob(TERMINAL_HANDLE * handle);
+void 			TERM_printJob(TERMINAL_HANDLE * handle, TermJob * job, const char * status);
+unsigned 		TERM_foregroundJob(TERMINAL_HANDLE * handle, TermJob * job);
+unsigned 		TERM_resumeJob(TERMINAL_HANDLE * handle, TermJob * job);
+#endif
+
+#if TERM_CMD_STATS == 1
+const TermCommandStats * TERM_getCommandStats(uint32_t index);
+void 			TERM_setCommandStackPeak(const char * command, uint32_t peak);
+void 			TERM_clearCommandStats();
+#endif
+
+#if TERM_SERVICE_TASK == 1 && (!__is_compiling || __has_include("FreeRTOS.h"))
+uint32_t 		TERM_feedInput(TERMINAL_HANDLE * handle, const uint8_t * data, uint32_t length, TickType_t timeout);
+uint32_t 		TERM_feedInputFromISR(TERMINAL_HANDLE * handle, const uint8_t * data, uint32_t length, BaseType_t * higherPriorityTaskWoken);
+unsigned 		TERM_service(TERMINAL_HANDLE * handle, TickType_t timeout);
+#endif
+
 
 #endif
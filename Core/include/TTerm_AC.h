@@ -34,30 +34,32 @@
 
 #include "TTerm.h"
 
-typedef struct __ACL__ AC_LIST_ELEMENT;
 typedef struct __ACL_HEAD__ AC_LIST_HEAD;
 
-struct __ACL__{
-    AC_LIST_ELEMENT * next;
-    char * string;
-};
-
+//the strings are kept sorted (by strcmp, const lists need to be sorted that way already) so all strings starting with some prefix are next to each other
 struct __ACL_HEAD__{
     unsigned isConst;
     uint32_t elementCount;
-    AC_LIST_ELEMENT * first;
+    char ** strings;        //const lists use the array they were created from
+    uint16_t * lengths;     //cached strlen of every string, only for non const lists
+    uint32_t size;          //number of strings the arrays have room for
+    uint32_t version;       //counts changes, completions that point into the list check it before reusing their candidates
 };
 
 AC_LIST_HEAD * ACL_create();
 AC_LIST_HEAD * ACL_createConst(char ** strings, uint32_t count);
-AC_LIST_ELEMENT * ACL_getNext(AC_LIST_ELEMENT * currElement);
+char * ACL_find(AC_LIST_HEAD * head, char * string);
 void ACL_add(AC_LIST_HEAD * head, char * string);
 void ACL_remove(AC_LIST_HEAD * head, char * string);
+uint32_t ACL_findSliceRange(char * const * strings, uint32_t count, const char * currInput, uint32_t length, uint32_t * first);
+uint32_t ACL_findRange(AC_LIST_HEAD * head, const char * currInput, uint32_t length, uint32_t * first);
 uint8_t TERM_doListAC(AC_LIST_HEAD * head, char * currInput, uint8_t length, char ** buff);
 uint8_t ACL_defaultCompleter(TERMINAL_HANDLE * handle, void * params);
+uint32_t ACL_complete(TERMINAL_HANDLE * handle, AC_LIST_HEAD * head, const char * currInput, uint32_t length);
 unsigned ACL_isSorted(char * a, char * b);
-void ACL_remove(AC_LIST_HEAD * head, char * string);
-void ACL_add(AC_LIST_HEAD * head, char * string);
+
+//const list head that can live in flash, for commands registered with TERM_STATIC_COMMAND_AC. array needs to be sorted (and an array, not a pointer)
+#define ACL_STATIC_CONST(name, array) const AC_LIST_HEAD name = {.isConst = 1, .elementCount = sizeof(array)/sizeof(char*), .strings = (char **) (array)}
 
 #define TERM_addCommandConstAC(CMDhandler, command, helptext, stack, ACList, CmdList) TERM_addCommandAC(TERM_addCommand(CMDhandler, command,helptext,stack,CmdList) \
                                                                                 , ACL_defaultCompleter, ACL_createConst((char**)ACList, sizeof(ACList)/sizeof(char*)))
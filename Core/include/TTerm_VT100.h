@@ -1,3 +1,8 @@
+#ifndef TTerm_VT100_H
+#define TTerm_VT100_H
+
+#include <stdint.h>
+
 
 
 enum vt100{
@@ -27,7 +32,11 @@ enum vt100{
     _VT100_CURSOR_RESTORE_POSITION,
     _VT100_CURSOR_ENABLE,
     _VT100_CURSOR_DISABLE,
-    _VT100_CLS
+    _VT100_CLS,
+    _VT100_BRACKETED_PASTE_ON,
+    _VT100_BRACKETED_PASTE_OFF,
+    _VT100_INSERT_CHAR,
+    _VT100_DELETE_CHAR
 };
 
 //VT100 cmds given to us by the terminal software (they need to be > 8 bits so the handler can tell them apart from normal characters)
@@ -43,8 +52,29 @@ enum vt100{
 #define _VT100_KEY_INS              0x1009
 #define _VT100_KEY_PAGE_UP          0x100a
 #define _VT100_KEY_PAGE_DOWN        0x100b
+#define _VT100_KEY_F1               0x100c
+#define _VT100_KEY_F2               0x100d
+#define _VT100_KEY_F3               0x100e
+#define _VT100_KEY_F4               0x100f
+#define _VT100_KEY_F5               0x1010
+#define _VT100_KEY_F6               0x1011
+#define _VT100_KEY_F7               0x1012
+#define _VT100_KEY_F8               0x1013
+#define _VT100_KEY_F9               0x1014
+#define _VT100_KEY_F10              0x1015
+#define _VT100_KEY_F11              0x1016
+#define _VT100_KEY_F12              0x1017
+#define _VT100_PASTE_START          0x1018
+#define _VT100_PASTE_END            0x1019
+#define _VT100_CURSOR_REPORT        0x101a      //the terminal answered a size probe, the new size is in termRows/termColumns of the handle
 #define _VT100_INVALID              0xffff
 
+//modifier flags the decoder ors onto the key codes above if shift/alt/ctrl was held down (ESC[1;5C = ctrl + cursor forward)
+#define _VT100_MOD_SHIFT            0x2000
+#define _VT100_MOD_ALT              0x4000
+#define _VT100_MOD_CTRL             0x8000
+#define _VT100_MOD_MASK             0xe000
+
 
 enum color{
     _VT100_BLACK,
@@ -57,4 +87,38 @@ enum color{
     _VT100_WHITE
 };
 
-#define _VT100_POS_IGNORE 0xffff
\ No newline at end of file
+#define _VT100_POS_IGNORE 0xffff
+
+//input decoder
+
+//maximum number of numeric parameters kept from a CSI sequence. Any further ones are dropped
+#ifndef TERM_VT100_MAX_PARAMS
+#define TERM_VT100_MAX_PARAMS 4
+#endif
+
+//a single byte can complete at most two keys (ESC followed by something that isn't part of a sequence)
+#define TERM_VT100_MAX_KEYS_PER_BYTE 2
+
+typedef struct{
+    uint8_t     state;
+    uint8_t     paramIndex;
+    uint8_t     privateMarker;
+    uint8_t     cursorReportPending;
+    uint16_t    params[TERM_VT100_MAX_PARAMS];
+} TermVT100Decoder;
+
+void        TERM_initVT100Decoder(TermVT100Decoder * decoder);
+uint32_t    TERM_decodeVT100(TermVT100Decoder * decoder, uint8_t c, uint16_t * keys);
+unsigned    TERM_isVT100DecoderIdle(TermVT100Decoder * decoder);
+void        TERM_expectVT100CursorReport(TermVT100Decoder * decoder);
+
+//output sequences
+
+//longest sequence the functions below build (ESC[65535;65535H)
+#define TERM_VT100_MAX_SEQUENCE_LENGTH 16
+
+const char *    TERM_getVT100Sequence(uint16_t cmd, uint16_t var, char * buffer, uint32_t * length);
+uint32_t        TERM_formatVT100CursorPos(char * buffer, uint16_t x, uint16_t y);
+const char *    TERM_getVT100Code(uint16_t cmd, uint8_t var);
+
+#endif
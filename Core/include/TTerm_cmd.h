@@ -32,12 +32,21 @@
 #include "TTerm.h"
 #include "TTerm_AC.h"
 
+extern AC_LIST_HEAD CMD_testACL;
 extern AC_LIST_HEAD * head;
 
 uint8_t CMD_testCommandHandler(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args);
 uint8_t TERM_testCommandAutoCompleter(TERMINAL_HANDLE * handle, void * params);
 uint8_t CMD_help(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args);
 uint8_t CMD_cls(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args);
+#if TERM_CMD_STATS == 1
+uint8_t CMD_cmdstat(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args);
+#endif
+#if TERM_MAX_JOBS > 0
+uint8_t CMD_jobs(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args);
+uint8_t CMD_fg(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args);
+uint8_t CMD_bg(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args);
+#endif
 uint8_t CMD_reset(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args);
 uint8_t CMD_top(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args);
 void CMD_top_task(void * handle);
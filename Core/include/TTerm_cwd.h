@@ -31,4 +31,9 @@ uint8_t CMD_ls(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args);
 uint8_t CMD_cd(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args);
 uint8_t CMD_mkdir(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args);
 
+uint8_t CWD_pathCompleter(TERMINAL_HANDLE * handle, void * params);
+void CWD_invalidateListing(const char * path);
+void CWD_dropListing(const char * path, uint32_t length);
+void CWD_releaseListing(TERMINAL_HANDLE * handle);
+
 #endif
\ No newline at end of file
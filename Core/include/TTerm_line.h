@@ -0,0 +1,52 @@
+/*
+ * TTerm
+ *
+ * Copyright (c) 2020 Thorben Zethoff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+    
+#ifndef TTerm_LINE_H
+#define TTerm_LINE_H
+
+#include <stdint.h>
+
+#include "TTerm.h"
+
+//line editor
+//inputBuffer is used as a gap buffer: whatever is in front of the cursor lives at the start of the buffer, whatever is behind it at the very end
+//(terminated by inputBuffer[TERM_INPUTBUFFER_SIZE - 1] which is always 0). Inserting, deleting and moving the cursor by one character never has to touch the rest of the line.
+//TERM_lineGetString closes the gap to get a normal zero terminated string; the next edit opens it up again
+
+void            TERM_lineClear(TERMINAL_HANDLE * handle);
+uint32_t        TERM_lineInsert(TERMINAL_HANDLE * handle, const char * data, uint32_t length);
+unsigned        TERM_lineDeleteBack(TERMINAL_HANDLE * handle);
+unsigned        TERM_lineDeleteForward(TERMINAL_HANDLE * handle);
+void            TERM_lineSetCursor(TERMINAL_HANDLE * handle, uint32_t position);
+const char  *   TERM_lineGetTail(TERMINAL_HANDLE * handle);
+char        *   TERM_lineGetString(TERMINAL_HANDLE * handle);
+void            TERM_lineSetString(TERMINAL_HANDLE * handle, const char * string);
+
+//redraw
+//the line remembers what is on the screen after the prompt, so switching between history entries and completions only sends the part that actually changed
+
+void            TERM_lineShow(TERMINAL_HANDLE * handle, const char * prefix, uint32_t prefixLength, const char * text, unsigned quote);
+void            TERM_lineShowInput(TERMINAL_HANDLE * handle);
+void            TERM_linePrint(TERMINAL_HANDLE * handle);
+
+#endif
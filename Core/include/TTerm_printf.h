@@ -0,0 +1,43 @@
+/*
+ * TTerm
+ *
+ * Copyright (c) 2020 Thorben Zethoff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+    
+#ifndef TTerm_PRINTF_H
+#define TTerm_PRINTF_H
+
+#include <stdint.h>
+#include <stdarg.h>
+
+//small printf replacement that streams its output into a callback instead of a buffer. Doesn't touch the heap and only needs one chunk buffer on the stack
+//supports %d %i %u %x %X %p %s %c %% with the flags - 0 + and space, a width and a precision (both can be *). h, l, ll and z are understood
+//floats are not supported
+
+//size of the chunks the output is handed to the sink in
+#ifndef TERM_FORMAT_CHUNK_SIZE
+#define TERM_FORMAT_CHUNK_SIZE 64
+#endif
+
+typedef void (* TermFormatSink)(void * context, const char * data, uint32_t length);
+
+uint32_t TERM_vformat(TermFormatSink sink, void * context, const char * format, va_list arg);
+
+#endif
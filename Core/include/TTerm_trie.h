@@ -0,0 +1,70 @@
+/*
+ * TTerm
+ *
+ * Copyright (c) 2020 Thorben Zethoff
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+    
+#ifndef TTerm_TRIE_H
+#define TTerm_TRIE_H
+
+#include <stdint.h>
+
+//radix trie over strings, used for completion. Keys are not copied, they need to stay valid as long as they are in the trie
+//nodes come from an arena of TERM_TRIE_BLOCK_SIZE nodes per allocation and are only given back all at once by TERM_trieFree (removed ones are reused)
+
+#ifndef TERM_TRIE_BLOCK_SIZE
+#define TERM_TRIE_BLOCK_SIZE 32
+#endif
+
+typedef struct __TermTrieNode__ TermTrieNode;
+typedef struct __TermTrieBlock__ TermTrieBlock;
+
+struct __TermTrieNode__{
+    const char *    label;          //part of the key this node adds, points into one of the keys below it
+    const char *    key;            //key ending in this node or NULL
+    TermTrieNode *  child;          //first child, children are sorted by the first character of their label
+    TermTrieNode *  next;           //next sibling
+    uint32_t        keyCount;       //number of keys in this node and below it
+    uint16_t        labelLength;
+};
+
+struct __TermTrieBlock__{
+    TermTrieBlock * next;
+    uint32_t        used;
+    TermTrieNode    nodes[TERM_TRIE_BLOCK_SIZE];
+};
+
+typedef struct{
+    TermTrieNode    root;
+    TermTrieBlock * blocks;
+    TermTrieNode *  freeNodes;
+    uint32_t        freeCount;
+} TermTrie;
+
+void                    TERM_trieInit(TermTrie * trie);
+void                    TERM_trieFree(TermTrie * trie);
+unsigned                TERM_trieInsert(TermTrie * trie, const char * key, uint32_t length);
+void                    TERM_trieRemove(TermTrie * trie, const char * key, uint32_t length);
+const TermTrieNode *    TERM_trieFindPrefix(const TermTrie * trie, const char * prefix, uint32_t length, uint32_t * depth);
+const TermTrieNode *    TERM_trieNarrow(const TermTrieNode * node, const char * prefix, uint32_t length, uint32_t * depth);
+const char *            TERM_trieGetKey(const TermTrieNode * node, uint32_t index);
+uint32_t                TERM_trieCommonPrefix(const TermTrieNode * node, uint32_t depth, const char ** example);
+
+#endif
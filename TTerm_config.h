@@ -11,11 +11,24 @@
 //Enable to add void * port argument to printer function calls. This can be useful if you have multiple Terminals running and don't want to use multiple printer functions
 #define EXTENDED_PRINTF 1
 
+//Use the small formatter built into TTerm for ttprintf instead of the printf of the port. It streams straight into the output without any heap use, but knows no floats and no %o (see TTerm_printf.h)
+//#define TERM_BUILTIN_PRINTF 1
+
 //Buffer sizes. If you don't have much ram to spare I recommend you decrease TERM_HISTORYSIZE, as every history position is the length of one input buffer
 #define TERM_INPUTBUFFER_SIZE 128
 #define TERM_HISTORYSIZE 16
 #define TERM_PROG_BUFFER_SIZE 32
 
+//Most arguments a command can get. Lines with more are rejected
+//#define TERM_MAX_ARGS 32
+
+//Size of the per terminal output buffer. Everything echoed while processing one block of input is collected in there and sent to the printer in one go
+#define TERM_OUTPUTBUFFER_SIZE 256
+
+//Terminal size assumed until the terminal answered the size probe (or if it never does)
+#define TERM_DEFAULT_ROWS 24
+#define TERM_DEFAULT_COLUMNS 80
+
 //Print a text when the terminal is started?
 #define TERM_ENABLE_STARTUP_TEXT
 
@@ -23,10 +36,64 @@
 //NOTE: this requires FreeRTOS
 #define TERM_startTaskPerCommand
 
+//Keep a pool of command tasks around instead of creating (and deleting) one for every command. Every entry is the stack size of a class of TERM_WORKERS_PER_CLASS workers.
+//A command runs on a free worker of the smallest class its stack fits into, if there is none it gets a task of its own like without the pool
+//NOTE: only used with TERM_startTaskPerCommand
+//#define TERM_WORKER_STACK_CLASSES {configMINIMAL_STACK_SIZE + 100, configMINIMAL_STACK_SIZE + 500}
+//#define TERM_WORKERS_PER_CLASS 2
+
+//Don't use the heap for running commands: the worker pool is created with xTaskCreateStatic & co. from fixed buffers and a command that finds no free worker is refused instead of getting a task of its own.
+//TERM_WORKER_STACK_WORDS is the sum of all entries of TERM_WORKER_STACK_CLASSES, all worker stacks are taken from one buffer of TERM_WORKERS_PER_CLASS times that
+//The history is kept in TERM_HISTORYSIZE full size lines in the handle, TERM_getLine returns a line buffer of the worker (give lines back with TERM_freeLine, not TERM_FREE) and a buffered print longer than TERM_OUTPUTBUFFER_SIZE is cut off
+//NOTE: this requires configSUPPORT_STATIC_ALLOCATION in FreeRTOSConfig.h and TERM_WORKER_STACK_CLASSES
+//#define TERM_STATIC_ALLOCATION 1
+//#define TERM_WORKER_STACK_WORDS (2 * configMINIMAL_STACK_SIZE + 600)
+
+//Give every terminal a task that waits for input and for messages from programs at the same time. A program that returns is cleaned up and a TERM_getLine request applied right away instead of with the next key.
+//Input has to be handed over with TERM_feedInput (or TERM_feedInputFromISR) then instead of calling TERM_processBuffer, it is buffered in a stream of TERM_FEED_BUFFER_SIZE bytes
+//NOTE: this requires TERM_startTaskPerCommand and configUSE_QUEUE_SETS in FreeRTOSConfig.h
+//#define TERM_SERVICE_TASK 1
+//#define TERM_SERVICE_STACK_SIZE (configMINIMAL_STACK_SIZE + 300)
+//#define TERM_FEED_BUFFER_SIZE 64
+
+//Job control: a command with a trailing '&' runs in the background while the terminal takes the next one, ctrl+z stops the one in the foreground. jobs, fg and bg work like in a shell.
+//Up to TERM_JOB_OUTPUT_SIZE bytes of what a job prints in the background are kept (newest ones) and printed once it is in the foreground again or done
+//NOTE: this requires TERM_startTaskPerCommand. A program that is stopped while it prints through the print handler of the port directly keeps whatever lock that might hold until it continues.
+//Set TERM_JOB_STOP_KEY to 0 if programs need ctrl+z themselves
+//#define TERM_MAX_JOBS 4
+//#define TERM_JOB_OUTPUT_SIZE 256
+//#define TERM_JOB_STOP_KEY 0x1a
+
+//Keep track of how much stack every command used (cmdstat lists it). With TERM_STACK_TUNING a command gets the most it used so far plus TERM_STACK_TUNING_MARGIN words instead of the stack size it was registered with, once it ran at least once.
+//What was learned can be saved with TERM_getCommandStats and given back at startup with TERM_setCommandStackPeak
+//NOTE: this requires TERM_startTaskPerCommand. The stack of a pooled worker can't be measured per command, only runs on a task of their own (or values given to TERM_setCommandStackPeak) are learned from. With the pool a command is never made bigger than it was registered with
+//#define TERM_CMD_STATS 1
+//#define TERM_CMD_STATS_SIZE 32
+//#define TERM_STACK_TUNING 1
+//#define TERM_STACK_TUNING_MARGIN 100
+
+//Put the built in commands (and everything else registered with TERM_STATIC_COMMAND) into a sorted table in flash instead of adding them to the heap at startup
+//NOTE: this requires TTerm_commands.ld to be included in the linker script
+//#define TERM_STATIC_COMMANDS 1
+
+//If the command set is fixed, tools/tterm_phash.py can generate a perfect hash table (TTerm_phash.h) for the static commands so they are found with one hash and one compare
+//NOTE: falls back to the binary search if the table doesn't match the commands in flash
+//#define TERM_PERFECT_HASH 1
+
+//If nothing starts with what was typed, complete to names that contain the typed characters in order instead (cmk -> chairMark). The best TERM_FUZZY_MAX_CANDIDATES matches are offered, best first
+//#define TERM_FUZZY_COMPLETION 1
+
+//Tab fills in what all candidates have in common, pressing it again prints them all in columns (like bash). Set to 0 to have every tab show the next candidate instead
+//NOTE: shift+tab always cycles through the candidates
+//#define TERM_TAB_LIST_CANDIDATES 1
+
 //Should the terminal implement a working directory and include basic file commands?
 //NOTE: this requires FatFS
 //#define TERM_SUPPORT_CWD 1
 
+//How many directory listings the path completer caches (least recently used one gets replaced). Commands of the shell that change a directory drop its listing, ls drops the one of the working directory
+//#define TERM_CWD_CACHE_SIZE 4
+
 //If you want to have the "reset" command available you can define what function should be called here
 #define TERM_RESET_FUNCTION(X) SYS_softwareReset()
 
@@ -41,18 +41,163 @@ uint8_t INPUT_handler(TERMINAL_HANDLE * handle, uint16_t c);
 
 static const char * AC_start_stop[] = {
     "-all",
+    "-cmd",
     "-cpu",
     "-disp",
     "-fileIO",
     "-fpu",
+    "-spawn",
     "-term",
     "fast"
 };
 
 #define CM_FILEIO_FILESIZE 15000
+#define CM_CMD_ROUNDS 100
+#define CM_SPAWN_ROUNDS 50
+#define CM_SPAWN_STACK (configMINIMAL_STACK_SIZE + 100)
+
+//the way commands used to be found: strncmp through every single one
+static const TermCommandDescriptor * CM_findCMDLinear(TermCommandDescriptor * head, const char * name, uint32_t length){
+    TermCommandIterator iterator;
+    TERM_initCommandIterator(&iterator, head);
+    const TermCommandDescriptor * currCmd;
+    while((currCmd = TERM_nextCommand(&iterator)) != NULL){
+        if(currCmd->commandLength == length && strncmp(name, currCmd->command, length) == 0) return currCmd;
+    }
+    return NULL;
+}
+
+//looks up every command (and one that doesn't exist) CM_CMD_ROUNDS times with both methods
+static void CM_benchmarkCMDLookup(TERMINAL_HANDLE * handle){
+    TermCommandDescriptor * head = handle->cmdListHead;
+    uint32_t lookups = 0;
+    uint32_t linearTime = 0;
+    uint32_t indexTime = 0;
+    uint32_t errors = 0;
+    
+    ttprintf("Testing command lookup (%d commands)... ", TERM_getCommandCount(head));
+    
+    uint32_t round = 0;
+    for(;round < CM_CMD_ROUNDS; round++){
+        TermCommandIterator iterator;
+        TERM_initCommandIterator(&iterator, head);
+        const TermCommandDescriptor * currCmd = TERM_nextCommand(&iterator);
+        
+        //a NULL currCmd is the miss at the end
+        do{
+            char * name = (currCmd != NULL) ? (char *) currCmd->command : "notACommand";
+            uint32_t length = strlen(name);
+            
+            uint32_t startTime = portGET_INSTRUCTION_COUNTER_VALUE();
+            const TermCommandDescriptor * linearResult = CM_findCMDLinear(head, name, length);
+            uint32_t midTime = portGET_INSTRUCTION_COUNTER_VALUE();
+            const TermCommandDescriptor * indexResult = TERM_findCMDFromName(head, name, length);
+            uint32_t endTime = portGET_INSTRUCTION_COUNTER_VALUE();
+            
+            linearTime += midTime - startTime;
+            indexTime += endTime - midTime;
+            if(linearResult != indexResult) errors++;
+            lookups++;
+            
+            if(currCmd == NULL) break;
+            currCmd = TERM_nextCommand(&iterator);
+        }while(1);
+    }
+    
+    ttprintf("done (%d lookups, %d mismatches)\r\n", lookups, errors);
+    ttprintf("\tlinear strncmp scan: t_instr = %u => %u per lookup\r\n", linearTime, linearTime / lookups);
+    ttprintf("\thashed lookup:       t_instr = %u => %u per lookup\r\n", indexTime, indexTime / lookups);
+}
+
+#if defined TERM_startTaskPerCommand && (!__is_compiling || __has_include("FreeRTOS.h"))
+static TaskHandle_t CM_spawnWaitingTask;
+static volatile uint32_t CM_spawnRunTime;
+
+//stands in for a command that does nothing: notes when it got to run and wakes the benchmark back up
+static void CM_spawnTask(void * pvParameters){
+    CM_spawnRunTime = portGET_INSTRUCTION_COUNTER_VALUE();
+    xTaskNotifyGive(CM_spawnWaitingTask);
+    vTaskDelete(NULL);
+    while(1);
+}
+
+//the same for a command run on a pooled worker, see TERM_WORKER_STACK_CLASSES
+static void CM_spawnWorkerTask(void * pvParameters){
+    while(1){
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        CM_spawnRunTime = portGET_INSTRUCTION_COUNTER_VALUE();
+        xTaskNotifyGive(CM_spawnWaitingTask);
+    }
+}
+
+//how long it takes from a command being entered until it runs: creating a task and its streams for every command and deleting them again, against waking up a task that is already there
+static void CM_benchmarkSpawn(TERMINAL_HANDLE * handle){
+    uint32_t createStartTime = 0;
+    uint32_t createTotalTime = 0;
+    uint32_t poolStartTime = 0;
+    uint32_t errors = 0;
+    
+    CM_spawnWaitingTask = xTaskGetCurrentTaskHandle();
+    
+    ttprintf("Testing command startup (%d rounds)... ", CM_SPAWN_ROUNDS);
+    
+    TaskHandle_t worker;
+    if(xTaskCreate(CM_spawnWorkerTask, "CM worker", CM_SPAWN_STACK, NULL, tskIDLE_PRIORITY + 1, &worker) != pdPASS){
+        ttprintf("couldn't create the worker task\r\n");
+        return;
+    }
+    
+    uint32_t round = 0;
+    for(;round < CM_SPAWN_ROUNDS; round++){
+        //a task per command
+        uint32_t startTime = portGET_INSTRUCTION_COUNTER_VALUE();
+        StreamBufferHandle_t inputStream = xStreamBufferCreate(TERM_PROG_BUFFER_SIZE, 1);
+        QueueHandle_t cmdStream = xQueueCreate(5, sizeof(Term_progCMD_t));
+        TaskHandle_t task;
+        if(inputStream != NULL && cmdStream != NULL && xTaskCreate(CM_spawnTask, "CM spawn", CM_SPAWN_STACK, NULL, tskIDLE_PRIORITY + 1, &task) == pdPASS){
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            createStartTime += CM_spawnRunTime - startTime;
+        }else{
+            errors++;
+        }
+        if(inputStream != NULL) vStreamBufferDelete(inputStream);
+        if(cmdStream != NULL) vQueueDelete(cmdStream);
+        createTotalTime += portGET_INSTRUCTION_COUNTER_VALUE() - startTime;
+        
+        //let the idle task free the deleted one
+        vTaskDelay(1);
+        
+        //pooled worker
+        startTime = portGET_INSTRUCTION_COUNTER_VALUE();
+        xTaskNotifyGive(worker);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        poolStartTime += CM_spawnRunTime - startTime;
+    }
+    
+    vTaskDelete(worker);
+    
+    ttprintf("done (%d failed task creations)\r\n", errors);
+    ttprintf("\ttask per command: t_instr = %u => %u until running, %u including cleanup\r\n", createStartTime, createStartTime / CM_SPAWN_ROUNDS, createTotalTime / CM_SPAWN_ROUNDS);
+    ttprintf("\tpooled worker:    t_instr = %u => %u until running\r\n", poolStartTime, poolStartTime / CM_SPAWN_ROUNDS);
+}
+#else
+static void CM_benchmarkSpawn(TERMINAL_HANDLE * handle){
+    ttprintf("Commands don't get a task of their own (TERM_startTaskPerCommand isn't set), nothing to compare\r\n");
+}
+#endif
+
+#if TERM_STATIC_COMMANDS == 1
+static ACL_STATIC_CONST(AC_start_stop_list, AC_start_stop);
+TERM_STATIC_COMMAND_AC(APP_NAME, CMD_main, APP_DESCRIPTION, configMINIMAL_STACK_SIZE + 200, ACL_defaultCompleter, &AC_start_stop_list);
+#endif
 
 uint8_t REGISTER_chairMark(TermCommandDescriptor * desc){
+#if TERM_STATIC_COMMANDS == 1
+    //already in the static command table, but that one only belongs to TERM_defaultList
+    if(desc == &TERM_defaultList) return 1;
+#endif
     TERM_addCommandConstAC(CMD_main, APP_NAME, APP_DESCRIPTION, configMINIMAL_STACK_SIZE + 200, AC_start_stop,desc);
+    return 1;
 }
 
 static uint8_t CMD_main(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
@@ -63,6 +208,8 @@ static uint8_t CMD_main(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args
     uint32_t FileIOBenchmarkFastModeEnabled = 0;
     uint32_t TerminalBenchmarkEnabled = 0;
     uint32_t DisplaybufferBenchmarkEnabled = 0;
+    uint32_t CMDBenchmarkEnabled = 0;
+    uint32_t SpawnBenchmarkEnabled = 0;
     
     for(;currArg<argCount; currArg++){
         if(strcmp(args[currArg], "-?") == 0){
@@ -75,6 +222,8 @@ static uint8_t CMD_main(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args
             ttprintf("\t\t\t -fileIO [fileSize] [fast]\t tests external storage performance\r\n");
             ttprintf("\t\t\t -term \t tests terminal printing speed\r\n");
             ttprintf("\t\t\t -disp \t tests display buffer performance\r\n");
+            ttprintf("\t\t\t -cmd \t compares command lookup against a linear scan\r\n");
+            ttprintf("\t\t\t -spawn \t compares starting a task per command against waking a pooled one\r\n");
             ttprintf("\t\t\t -all \t tests everything\r\n");
     
             return TERM_CMD_EXIT_SUCCESS;
@@ -86,6 +235,8 @@ static uint8_t CMD_main(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args
             FileIOBenchmarkEnabled = 1;
             TerminalBenchmarkEnabled = 1;
             DisplaybufferBenchmarkEnabled = 1;
+            CMDBenchmarkEnabled = 1;
+            SpawnBenchmarkEnabled = 1;
         }
         
         if(strcmp(args[currArg], "-cpu") == 0){
@@ -118,8 +269,19 @@ static uint8_t CMD_main(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args
         if(strcmp(args[currArg], "-disp") == 0){
             DisplaybufferBenchmarkEnabled = 1;
         }
+        
+        if(strcmp(args[currArg], "-cmd") == 0){
+            CMDBenchmarkEnabled = 1;
+        }
+        
+        if(strcmp(args[currArg], "-spawn") == 0){
+            SpawnBenchmarkEnabled = 1;
+        }
     }
     
+    if(CMDBenchmarkEnabled) CM_benchmarkCMDLookup(handle);
+    if(SpawnBenchmarkEnabled) CM_benchmarkSpawn(handle);
+    
 #ifdef TERM_SUPPORT_CWD 
     if(FileIOBenchmarkEnabled){
         uint32_t bytesTransferred = 0;
@@ -45,8 +45,17 @@
 
 	static uint8_t CMD_main(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args);
 
+#if TERM_STATIC_COMMANDS == 1
+	TERM_STATIC_COMMAND(APP_NAME, CMD_main, APP_DESCRIPTION, 0);
+#endif
+
 	uint8_t REGISTER_top(TermCommandDescriptor * desc){
+#if TERM_STATIC_COMMANDS == 1
+		//already in the static command table, but that one only belongs to TERM_defaultList
+		if(desc == &TERM_defaultList) return 1;
+#endif
 		TERM_addCommand(CMD_main, APP_NAME, APP_DESCRIPTION, 0, desc);
+		return 1;
 	}
 
 	static uint8_t CMD_main(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
@@ -91,8 +100,15 @@
 
 				uint32_t totalLoad = 0;
 
+				//only print as many tasks as fit on the screen (the header takes 7 lines, the interrupt line 2)
+				uint32_t visibleTasks = (handle->termRows > 9) ? handle->termRows - 9 : 1;
+
 				TaskStatus_t ** sorted = createSortedList(taskStats, taskCount, currSortingMode);
 				for(uint32_t currTask = 0; currTask < taskCount; currTask++){
+					//the load still needs to be added up for the tasks that don't fit anymore
+					totalLoad += sorted[currTask]->currCPULoad;
+					if(currTask >= visibleTasks) continue;
+
 					//make sure name is zero terminated
 					char name[configMAX_TASK_NAME_LEN+1];
 					strncpy(name, sorted[currTask]->pcTaskName, configMAX_TASK_NAME_LEN);
@@ -106,8 +122,6 @@
 							, 37 + configMAX_TASK_NAME_LEN, sorted[currTask]->ulRunTimeCounter
 							, 47 + configMAX_TASK_NAME_LEN, sorted[currTask]->usStackHighWaterMark
 							, 55 + configMAX_TASK_NAME_LEN, sorted[currTask]->usedHeap);
-
-					totalLoad += sorted[currTask]->currCPULoad;
 				}
 
 				uint32_t isrLoad = 1000-totalLoad;
@@ -32,6 +32,9 @@
 
 #include "string.h"
 #include "ff.h"
+#if TERM_SUPPORT_CWD == 1
+#include "TTerm_cwd.h"
+#endif
 
 #define APP_NAME "tte"
 #define APP_DESCRIPTION "editor"
@@ -44,7 +47,11 @@ static void TASK_main(void *pvParameters);
 static uint8_t INPUT_handler(TERMINAL_HANDLE * handle, uint16_t c);
 
 uint8_t REGISTER_tte(TermCommandDescriptor * desc){
+#if TERM_SUPPORT_CWD == 1
+    TERM_addCommandAC(TERM_addCommand(CMD_main, APP_NAME, APP_DESCRIPTION, 0, desc), CWD_pathCompleter, 0);
+#else
     TERM_addCommand(CMD_main, APP_NAME, APP_DESCRIPTION, 0, desc); 
+#endif
 }
 
 static uint8_t CMD_main(TERMINAL_HANDLE * handle, uint8_t argCount, char ** args){
@@ -281,17 +288,19 @@ struct a_buf {
     TERMINAL_HANDLE * handle;
 };
 
+// Special keys arrive already decoded by the terminal (see TERM_decodeVT100),
+// these are just the names the editor uses for them.
 enum editor_key {
     BACKSPACE = 0x7f, // 127
-    ARROW_LEFT = 0x3e8, // 1000, large value out of the range of a char.
-    ARROW_RIGHT,
-    ARROW_UP,
-    ARROW_DOWN,
-    PAGE_UP,
-    PAGE_DOWN,
-    HOME_KEY,
-    END_KEY,
-    DEL_KEY
+    ARROW_LEFT = _VT100_CURSOR_BACK,
+    ARROW_RIGHT = _VT100_CURSOR_FORWARD,
+    ARROW_UP = _VT100_CURSOR_UP,
+    ARROW_DOWN = _VT100_CURSOR_DOWN,
+    PAGE_UP = _VT100_KEY_PAGE_UP,
+    PAGE_DOWN = _VT100_KEY_PAGE_DOWN,
+    HOME_KEY = _VT100_KEY_POS1,
+    END_KEY = _VT100_KEY_END,
+    DEL_KEY = _VT100_KEY_DEL
 };
 
 enum editor_highlight {
@@ -600,81 +609,29 @@ void die(TERMINAL_HANDLE * handle, const char* s) {
 }
 
 int editorReadKey(TERMINAL_HANDLE * handle) {
-
-    char c;
-    while (xStreamBufferReceive(handle->currProgram->inputStream,&c,1,portMAX_DELAY) != 1) {
-        // Ignoring EAGAIN to make it work on Cygwin.
+    // The terminal already ran the input through its escape sequence
+    // decoder, every entry in the stream is one 16 bit key.
+    uint16_t c;
+    while (xStreamBufferReceive(handle->currProgram->inputStream,&c,sizeof(c),portMAX_DELAY) != sizeof(c)) {
 
     }
 
-    // Check escape sequences, if first byte
-    // is an escape character then...
-    if (c == '\x1b') {
-        char seq[3];
-        if (xStreamBufferReceive(handle->currProgram->inputStream,&seq[0],1,portMAX_DELAY) != 1 ||
-            xStreamBufferReceive(handle->currProgram->inputStream,&seq[1],1,portMAX_DELAY) != 1)
-            return '\x1b';
-
-        if (seq[0] == '[') {
-            if (seq[1] >= '0' && seq[1] <= '9') {
-                if (xStreamBufferReceive(handle->currProgram->inputStream,&seq[2],1,portMAX_DELAY) != 1)
-                    return '\x1b';
-                if (seq[2] == '~') {
-                    switch (seq[1]) {
-                        // Home and End keys may be sent in many ways depending on the OS
-                        // \x1b[1~, \x1b[7~, \x1b[4~, \x1b[8~
-                        case '1':
-                        case '7':
-                            return HOME_KEY;
-                        case '4':
-                        case '8':
-                            return END_KEY;
-                        // Del key is sent as \x1b[3~
-                        case '3':
-                            return DEL_KEY;
-                        // Page Up and Page Down send '\x1b', '[', '5' or '6' and '~'.
-                        case '5': return PAGE_UP;
-                        case '6': return PAGE_DOWN;
-                    }
-                }
-            } else {
-                switch (seq[1]) {
-                    // Arrow keys send multiple bytes starting with '\x1b', '[''
-                    // and followed by an 'A', 'B', 'C' or 'D' depending on which
-                    // arrow is pressed.
-                    case 'A': return ARROW_UP;
-                    case 'B': return ARROW_DOWN;
-                    case 'C': return ARROW_RIGHT;
-                    case 'D': return ARROW_LEFT;
-                    // Home key can also be sent as \x1b[H
-                    case 'H': return HOME_KEY;
-                    // End key can also be sent as \x1b[F
-                    case 'F': return END_KEY;
-                }
-            }
-        } else if (seq[0] == 'O') {
-            switch (seq[1]) {
-                // Yes, Home key can ALSO be sent as \x1bOH
-                case 'H': return HOME_KEY;
-                // And... End key as \x1bOF
-                case 'F': return END_KEY;
-            }
-        }
-        return '\x1b';
-    } else {
-        return c;
-    }
+    // The editor doesn't use any modifier combinations (yet).
+    if (c != _VT100_INVALID)
+        c &= ~_VT100_MOD_MASK;
+    return c;
 }
 
-int getWindowSize(int* screen_rows, int* screen_cols) {
-    *screen_cols = 80;
-    *screen_rows = 24;
+int getWindowSize(TERMINAL_HANDLE * handle, int* screen_rows, int* screen_cols) {
+    // The terminal keeps track of its size (see TERM_probeSize), it
+    // falls back to 80x24 if the terminal never answered.
+    *screen_cols = handle->termColumns;
+    *screen_rows = handle->termRows;
     return 0;
-
 }
 
 void editorUpdateWindowSize(editor_config * ec, TERMINAL_HANDLE * handle) {
-    if (getWindowSize(&ec->screen_rows, &ec->screen_cols) == -1)
+    if (getWindowSize(handle, &ec->screen_rows, &ec->screen_cols) == -1)
         die(handle, "Failed to get window size");
     ec->screen_rows -= 2; // Room for the status bar.
 }
@@ -1309,6 +1266,10 @@ void editorSave(editor_config * ec, TERMINAL_HANDLE * handle) {
         // Writing the file.
         uint bytes_written=0;
         f_write(out, buf, len, &bytes_written);
+#if TERM_SUPPORT_CWD == 1
+        //the file name is relative to wherever fatfs is, so we can't tell which listing is affected
+        CWD_invalidateListing(NULL);
+#endif
         if (bytes_written == len) {
             f_close(out);
             vPortFree(buf);
@@ -1742,7 +1703,7 @@ void redo(editor_config * ec) {
 void abufFlush(struct a_buf * ab){
     if(ab->len==0) return;
     TERMINAL_HANDLE * handle = ab->handle;
-    ttprintf("%.*s",ab->len,ab->buf);
+    ttwrite(ab->buf, ab->len);
     ab->len = 0;
 }
 
@@ -1915,9 +1876,10 @@ void editorDrawRows(editor_config * ec, struct a_buf* ab) {
                     abufAppend(ab, &sym, 1);
                     abufAppend(ab, "\x1b[m", 3);
                     if (current_color != -1) {
-                        char buf[16];
-                        int c_len = snprintf(buf, sizeof(buf), "\x1b[%dm", current_color);
-                        abufAppend(ab, buf, c_len);
+                        char buf[TERM_VT100_MAX_SEQUENCE_LENGTH];
+                        uint32_t c_len;
+                        const char * seq = TERM_getVT100Sequence(_VT100_FOREGROUND_COLOR, current_color - 30, buf, &c_len);
+                        abufAppend(ab, seq, c_len);
                     }
                 } else if (highlight[j] == HL_NORMAL) {
                     if (current_color != -1) {
@@ -1931,9 +1893,10 @@ void editorDrawRows(editor_config * ec, struct a_buf* ab) {
                     // from the last character's color.
                     if (color != current_color) {
                         current_color = color;
-                        char buf[16];
-                        int c_len = snprintf(buf, sizeof(buf), "\x1b[%dm", color);
-                        abufAppend(ab, buf, c_len);
+                        char buf[TERM_VT100_MAX_SEQUENCE_LENGTH];
+                        uint32_t c_len;
+                        const char * seq = TERM_getVT100Sequence(_VT100_FOREGROUND_COLOR, color - 30, buf, &c_len);
+                        abufAppend(ab, seq, c_len);
                     }
 
                     abufAppend(ab, &c[j], 1);
@@ -1967,9 +1930,9 @@ void editorRefreshScreen(editor_config * ec, TERMINAL_HANDLE * handle) {
     editorDrawMessageBar(ec, &ab);
 
     // Moving the cursor where it should be.
-    char buf[32];
-    snprintf(buf, sizeof(buf), "\x1b[%d;%dH", (ec->cursor_y - ec->row_offset) + 1, (ec->render_x - ec->col_offset) + 1);
-    abufAppend(&ab, buf, strlen(buf));
+    char buf[TERM_VT100_MAX_SEQUENCE_LENGTH];
+    uint32_t len = TERM_formatVT100CursorPos(buf, (ec->render_x - ec->col_offset) + 1, (ec->cursor_y - ec->row_offset) + 1);
+    abufAppend(&ab, buf, len);
 
     // Showing again the cursor.
     abufAppend(&ab, "\x1b[?25h", 6);
@@ -2080,9 +2043,7 @@ void editorMoveCursor(editor_config * ec, uint16_t key) {
 void editorProcessKeypress(editor_config * ec, TERMINAL_HANDLE * handle) {
     static int quit_times = TTE_QUIT_TIMES;
 
-    //int c = editorReadKey(handle);
-    uint16_t c;
-    xStreamBufferReceive(handle->currProgram->inputStream,&c,2,portMAX_DELAY);
+    int c = editorReadKey(handle);
 
     switch (c) {
         case '\r': // Enter key
@@ -2172,6 +2133,9 @@ void editorProcessKeypress(editor_config * ec, TERMINAL_HANDLE * handle) {
                 makeAction(ec, DelChar, string);
             }
             break;
+        case _VT100_CURSOR_REPORT: // Answer to TERM_probeSize, the size might have changed.
+            editorHandleSigwinch(ec, handle);
+            break;
         case CTRL_KEY('l'):
         case '\x1b': // Escape key
             break;
@@ -2221,6 +2185,10 @@ void initEditor(editor_config* ec, TERMINAL_HANDLE * handle) {
     ec->actions = actionListInit();
 
     editorUpdateWindowSize(ec, handle);
+
+    // Ask again in case the window was resized since the terminal
+    // started, the answer shows up as a _VT100_CURSOR_REPORT key.
+    TERM_probeSize(handle);
 }
 
 void printHelp(TERMINAL_HANDLE * handle) {
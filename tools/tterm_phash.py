@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+#
+# TTerm
+#
+# Copyright (c) 2020 Thorben Zethoff
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the "Software"), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+# the Software, and to permit persons to whom the Software is furnished to do so,
+# subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+# FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+# IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+# CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+"""Generates TTerm_phash.h, a minimal perfect hash table for the static command table (TERM_STATIC_COMMANDS + TERM_PERFECT_HASH).
+
+Command names are taken from the TERM_STATIC_COMMAND(...) registrations in the given .c/.h files
+(string literals or defines of one in the same file) and from .txt files with one name per line.
+The preprocessor isn't evaluated, so commands that are compiled out have to be excluded with -x.
+TTerm checks the table against the commands in flash at the first lookup and ignores it if they don't match.
+
+usage: tterm_phash.py [-o TTerm_phash.h] [-x name] files...
+"""
+
+import argparse
+import re
+import sys
+
+FNV_PRIME = 16777619
+MASK = 0xffffffff
+LOAD_FACTOR = 4         # average number of commands per bucket
+
+REGISTRATION = re.compile(r'TERM_STATIC_COMMAND(?:_AC)?\s*\(\s*("(?:[^"\\]|\\.)*"|[A-Za-z_]\w*)')
+DEFINE = re.compile(r'^\s*#\s*define\s+([A-Za-z_]\w*)\s+("(?:[^"\\]|\\.)*")', re.MULTILINE)
+
+
+def perfect_hash_keys(name, seed):
+    """Same as TERM_perfectHash in TTerm.c, returns (hash, mixed)"""
+    h = seed
+    for c in name:
+        h ^= c
+        h = (h * FNV_PRIME) & MASK
+
+    m = h ^ (h >> 16)
+    m = (m * 0x85ebca6b) & MASK
+    m ^= m >> 13
+    m = (m * 0xc2b2ae35) & MASK
+    m ^= m >> 16
+    return h, m
+
+
+def slot(h, m, displacement, n):
+    return ((h % n) + (displacement // n) * ((m >> 16) % n) + (displacement % n)) % n
+
+
+def unquote(literal):
+    return bytes(literal[1:-1], 'utf-8').decode('unicode_escape').encode('latin-1')
+
+
+def scan_source(path):
+    with open(path, encoding='utf-8', errors='replace') as f:
+        text = f.read()
+
+    # drop comments so commented out registrations don't count
+    text = re.sub(r'/\*.*?\*/', '', text, flags=re.DOTALL)
+    text = re.sub(r'//[^\n]*', '', text)
+
+    defines = {name: value for name, value in DEFINE.findall(text)}
+    names = []
+    for arg in REGISTRATION.findall(text):
+        if arg.startswith('"'):
+            names.append(unquote(arg))
+        elif arg in defines:
+            names.append(unquote(defines[arg]))
+        elif arg != 'name':
+            # 'name' is the parameter in the definition of the macro itself
+            print('warning: %s: can\'t resolve command name %s, skipping it' % (path, arg), file=sys.stderr)
+    return names
+
+
+def generate(names, max_seeds=1000):
+    n = len(names)
+    bucket_count = max(1, (n + LOAD_FACTOR - 1) // LOAD_FACTOR)
+
+    for seed in range(0x811c9dc5, 0x811c9dc5 + max_seeds):
+        keys = [perfect_hash_keys(name, seed) for name in names]
+
+        buckets = [[] for _ in range(bucket_count)]
+        for index, (h, m) in enumerate(keys):
+            buckets[(m & 0xffff) % bucket_count].append(index)
+
+        displacements = [0] * bucket_count
+        slots = [None] * n
+
+        # biggest buckets first, they are the hardest to place
+        for bucket in sorted(range(bucket_count), key=lambda b: -len(buckets[b])):
+            members = buckets[bucket]
+            if not members:
+                break
+
+            for displacement in range(n * n):
+                wanted = [slot(keys[i][0], keys[i][1], displacement, n) for i in members]
+                if len(set(wanted)) == len(wanted) and all(slots[s] is None for s in wanted):
+                    for i, s in zip(members, wanted):
+                        slots[s] = i
+                    displacements[bucket] = displacement
+                    break
+            else:
+                break
+        else:
+            return seed, displacements, slots
+
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generates a perfect hash table for TTerm\'s static commands')
+    parser.add_argument('files', nargs='+', help='.c/.h files with TERM_STATIC_COMMAND registrations or .txt files with one command name per line')
+    parser.add_argument('-o', '--output', default='TTerm_phash.h')
+    parser.add_argument('-x', '--exclude', action='append', default=[], help='command that is registered but compiled out')
+    args = parser.parse_args()
+
+    names = []
+    for path in args.files:
+        if path.endswith('.txt'):
+            with open(path, 'rb') as f:
+                names += [line.strip() for line in f if line.strip()]
+        else:
+            names += scan_source(path)
+
+    excluded = {x.encode('utf-8') for x in args.exclude}
+    names = [name for name in names if name not in excluded]
+
+    if not names:
+        sys.exit('error: no commands found')
+
+    duplicates = {name for name in names if names.count(name) > 1}
+    if duplicates:
+        sys.exit('error: commands registered more than once: ' + ', '.join(sorted(d.decode('utf-8', 'replace') for d in duplicates)))
+
+    # the linker sorts the table by byte value of the name (SORT_BY_NAME), the index table has to point into that order
+    names.sort()
+
+    result = generate(names)
+    if result is None:
+        sys.exit('error: couldn\'t find a perfect hash function')
+    seed, displacements, slots = result
+
+    n = len(names)
+    index_type = 'uint8_t' if n <= 0x100 else 'uint16_t'
+
+    with open(args.output, 'w') as out:
+        out.write('//generated by tools/tterm_phash.py, do not edit\n')
+        out.write('//commands: %s\n\n' % ' '.join(name.decode('utf-8', 'replace') for name in names))
+        out.write('#ifndef TTerm_PHASH_H\n#define TTerm_PHASH_H\n\n')
+        out.write('#include <stdint.h>\n\n')
+        out.write('#define TERM_PHASH_COUNT %d\n' % n)
+        out.write('#define TERM_PHASH_BUCKETS %d\n' % len(displacements))
+        out.write('#define TERM_PHASH_SEED 0x%08xu\n\n' % seed)
+        out.write('static const uint32_t TERM_phashDisplacements[TERM_PHASH_BUCKETS] = {\n    %s\n};\n\n' % ', '.join(str(d) for d in displacements))
+        out.write('//slot -> position of the command in the static table\n')
+        out.write('static const %s TERM_phashIndex[TERM_PHASH_COUNT] = {\n    %s\n};\n\n' % (index_type, ', '.join(str(i) for i in slots)))
+        out.write('#endif\n')
+
+    print('%d commands, %d buckets, seed 0x%08x -> %s' % (n, len(displacements), seed, args.output))
+
+
+if __name__ == '__main__':
+    main()